@@ -8,61 +8,932 @@
 #ifdef __APPLE__
 #include <mach/mach.h>
 #endif // for std::runtime_error
+#ifdef __linux__
+#include <linux/perf_event.h> // hardware counters for the layout benchmarks
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fcntl.h>  // PSI and cgroup files for pressure_monitor
+#include <poll.h>
+#include <cerrno>
+#include <cstdio>
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>     // mmap/madvise for reserved ranges and huge pages
+#include <sys/resource.h> // getrusage for page fault counts
+#endif
 #include <chrono>    // for timing
+#include <algorithm> // for std::remove_if
+#include <memory>    // for std::unique_ptr
+#include <random>    // for benchmark index streams
+#include <cstdint>
+#include <cstddef>    // for offsetof
+#include <functional> // for std::function
+#include <cstring>    // for std::memcpy
+#include <cstdlib>    // for std::calloc
+#include <type_traits>
+#include <thread>     // background helpers (scavenger)
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h> // SSE4.2/AVX2/AVX-512 occupancy kernels, selected at runtime
+#define POOL_X86_KERNELS 1
+#endif
+// AddressSanitizer cannot see use-after-erase inside blocks the pool reuses itself,
+// so free slots are poisoned by hand; outside ASan builds the macros expand to nothing
+#if defined(__SANITIZE_ADDRESS__)
+#define POOL_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define POOL_ASAN 1
+#endif
+#endif
+#ifdef POOL_ASAN
+#include <sanitizer/asan_interface.h>
+#define POOL_POISON_MEMORY(addr, size) ASAN_POISON_MEMORY_REGION((addr), (size))
+#define POOL_UNPOISON_MEMORY(addr, size) ASAN_UNPOISON_MEMORY_REGION((addr), (size))
+#define POOL_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define POOL_POISON_MEMORY(addr, size) ((void)(addr), (void)(size))
+#define POOL_UNPOISON_MEMORY(addr, size) ((void)(addr), (void)(size))
+#define POOL_NO_SANITIZE_ADDRESS
+#endif
+
+// Type-erased view of a pool, for management code that does not know T
+// (plugins, stats exporters, trimming). Typed access (push_back, operator[])
+// stays on the concrete pool; the concrete pools are final, so calls through
+// a typed reference are devirtualized.
+
+struct pool_stats {
+    size_t live = 0;            // constructed objects
+    size_t slots = 0;           // index high-water mark
+    size_t capacity = 0;        // slots the pool can address without growing
+    size_t free_slots = 0;      // holes below the high-water mark ready for reuse
+    size_t blocks = 0;          // blocks currently holding memory
+    size_t element_size = 0;    // bytes per slot (object + padding)
+    size_t committed_bytes = 0; // bytes held in blocks
+    size_t decommitted_bytes = 0; // free-slot pages returned to the OS by decommit_idle, in total
+    size_t realtime_violations = 0; // operations that allocated after enable_realtime()
+    size_t locked_bytes = 0;        // bytes currently mlock'ed
+    size_t lock_failures = 0;       // blocks left unlocked because mlock failed (RLIMIT_MEMLOCK)
+    size_t claimed_slots = 0;       // slots handed out by claim() and not yet published
+    size_t leased_slots = 0;        // slots held by leases or cached per thread for them
+    size_t grows = 0;               // blocks added by grow()
+    size_t growth_block = 0;        // adaptive growth: capacity it chose for the last block
+    const char* growth_limit = nullptr; // adaptive growth: what decided that capacity
+};
+
+struct pool_snapshot {
+    size_t element_size = 0;           // sizeof(T)
+    bool has_bytes = false;            // raw bytes are only captured for trivially copyable T
+    std::vector<size_t> indices;       // live slot indices, ascending
+    std::vector<unsigned char> bytes;  // indices.size() * element_size bytes when has_bytes
+};
+
+struct raw_slot {
+    void* ptr;              // the live object
+    size_t index;
+    size_t size;            // sizeof(T)
+    void (*destroy)(void*); // runs ~T() on an object of this pool's type
+};
+
+// A queue that may hold handles to a pool's objects, see spsc_queue
+class handle_queue {
+public:
+    virtual ~handle_queue() = default;
+    virtual size_t in_flight() const = 0;
+};
+
+class any_pool {
+public:
+    static constexpr size_t npos = size_t(-1);
+    virtual ~any_pool() = default;
+    virtual pool_stats stats() const = 0;
+    // Release blocks that hold no live objects; returns bytes given back
+    virtual size_t trim() = 0;
+    // Move live objects into the lowest free slots. If remap is given it receives
+    // old index -> new index (npos for dead slots). Returns the number of objects moved.
+    virtual size_t compact(std::vector<size_t>* remap) = 0;
+    virtual pool_snapshot snapshot() const = 0;
+    virtual void visit_slots(const std::function<void(const raw_slot&)>& f) = 0;
+    virtual void erase(size_t idx) = 0;
+    virtual bool is_alive(size_t idx) const = 0;
+    // Return the pages of free slots that have seen no erase for min_idle to the OS,
+    // at most max_bytes per call. Pools that cannot decommit return 0.
+    virtual size_t decommit_idle(std::chrono::steady_clock::duration, size_t) { return 0; }
+    // Background helpers (pool_scavenger) lock this around their calls. Owners that
+    // hand a pool to such a helper take it around their own mutations.
+    std::mutex& maintenance_mutex() const { return maintenance; }
+    // Queues carrying handles to this pool's objects register here; operations that
+    // move objects refuse to run while any of them is non-empty
+    void attach_queue(const handle_queue* q) {
+        std::lock_guard<std::mutex> lock(queue_registry);
+        queues.push_back(q);
+    }
+    void detach_queue(const handle_queue* q) {
+        std::lock_guard<std::mutex> lock(queue_registry);
+        queues.erase(std::remove(queues.begin(), queues.end(), q), queues.end());
+    }
+    size_t handles_in_flight() const {
+        std::lock_guard<std::mutex> lock(queue_registry);
+        size_t n = 0;
+        for (const handle_queue* q : queues) n += q->in_flight();
+        return n;
+    }
+private:
+    mutable std::mutex maintenance;
+    mutable std::mutex queue_registry;
+    std::vector<const handle_queue*> queues;
+};
+
+// Slot layout: objects are padded to a multiple of 64 bytes (stride).
+// A stride that is a multiple of 1 KB puts the same field of consecutive objects
+// into at most 4 of the 64 L1 sets and onto the same page offset, so iterating one
+// field across objects thrashes a few sets. Such strides get one extra cache line
+// (cache-set coloring): consecutive objects then rotate through all sets.
+template<typename T>
+constexpr bool default_stride_coloring = ((sizeof(T) + 63) / 64 * 64) % 1024 == 0;
+
+template<typename T, bool Color = default_stride_coloring<T>>
+struct pool_layout {
+    static constexpr bool colored = Color;
+    static constexpr bool contiguous = true; // slot j is at j * stride
+    static constexpr bool huge_pages = false;
+    static constexpr size_t stride = (sizeof(T) + 63) / 64 * 64 + (Color ? 64 : 0);
+    static constexpr size_t padding = stride - sizeof(T);
+    static constexpr size_t block_alignment = 64;
+    static constexpr size_t offset_of(size_t j) { return j * stride; }
+    static constexpr size_t slot_of(size_t offset) { return offset / stride; }
+    static constexpr size_t block_bytes(size_t capacity) { return capacity * stride; }
+    static constexpr size_t round_capacity(size_t capacity) { return capacity; }
+};
+
+// Straddle-free layout: a block is a sequence of runs of RunBytes, each run holds
+// per_run objects and its tail (RunBytes - per_run * stride) stays unused, so no object
+// crosses a run boundary. Block capacities are rounded up to whole runs (round_capacity),
+// so every committed run holds objects. Objects up to a page use 4 KB runs and touch one page each.
+// Larger objects (MyClass is 4160 bytes) must span several 4 KB pages anyway, so they use
+// 2 MB runs backed by transparent huge pages: one TLB entry and one fault per run.
+template<typename T, size_t RunBytes = ((sizeof(T) + 63) / 64 * 64 <= 4096 ? 4096 : (size_t(2) << 20))>
+struct page_run_layout {
+    static constexpr bool colored = false;
+    static constexpr bool contiguous = false;
+    static constexpr bool huge_pages = RunBytes > 4096;
+    static constexpr size_t stride = (sizeof(T) + 63) / 64 * 64;
+    static constexpr size_t padding = stride - sizeof(T);
+    static constexpr size_t run_bytes = RunBytes;
+    static constexpr size_t per_run = RunBytes / stride;
+    static_assert(per_run > 0, "RunBytes must hold at least one object");
+    static constexpr size_t block_alignment = RunBytes;
+    static constexpr size_t offset_of(size_t j) { return (j / per_run) * RunBytes + (j % per_run) * stride; }
+    static constexpr size_t slot_of(size_t offset) { return offset / RunBytes * per_run + offset % RunBytes / stride; }
+    static constexpr size_t block_bytes(size_t capacity) { return (capacity + per_run - 1) / per_run * RunBytes; }
+    static constexpr size_t round_capacity(size_t capacity) { return (capacity + per_run - 1) / per_run * per_run; }
+};
+
+// Page decommit for free slots: the pages stay mapped and read back as zeroes
+// on the next touch, so a reused slot just faults in a fresh page.
+inline size_t decommit_pages(char* begin, char* end) {
+#if defined(__linux__) || defined(__APPLE__)
+    const uintptr_t page = 4096;
+    uintptr_t first = (reinterpret_cast<uintptr_t>(begin) + page - 1) & ~(page - 1);
+    uintptr_t last = reinterpret_cast<uintptr_t>(end) & ~(page - 1);
+    if (last <= first) return 0;
+#ifdef __linux__
+    if (madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED) != 0) return 0;
+#else
+    if (madvise(reinterpret_cast<void*>(first), last - first, MADV_FREE) != 0) return 0;
+#endif
+    return last - first;
+#else
+    (void)begin; (void)end;
+    return 0;
+#endif
+}
+
+// Decommits the pages lying entirely inside runs of free slots of one block,
+// where slot j starts at base + Layout::offset_of(j). Starts at slot resume and
+// stops once max_bytes is reached; resume is left at the next slot to look at,
+// or 0 once the whole block has been covered.
+template<typename Layout, typename IsFree>
+size_t decommit_free_slots(char* base, size_t slots, IsFree&& is_free, size_t max_bytes, size_t& resume) {
+    size_t released = 0;
+    size_t j = resume;
+    while (j < slots && released < max_bytes) {
+        if (!is_free(j)) { ++j; continue; }
+        size_t run_end = j;
+        while (run_end < slots && is_free(run_end)) ++run_end;
+        released += decommit_pages(base + Layout::offset_of(j), base + Layout::offset_of(run_end - 1) + Layout::stride);
+        j = run_end;
+    }
+    resume = j < slots ? j : 0;
+    return released;
+}
+
+// Idle detection for decommit_idle: erase only bumps a counter, the scavenger
+// notices when the counter stops moving and decommits once min_idle has passed.
+struct idle_tracker {
+    size_t erases = 0;
+    size_t seen_erases = 0;
+    std::chrono::steady_clock::time_point quiet_since{};
+    bool scavenged = false;
+    size_t resume = 0; // slot where a decommit pass that ran out of budget continues
+
+    bool ready(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::duration min_idle) {
+        if (erases != seen_erases) {
+            seen_erases = erases;
+            quiet_since = now;
+            scavenged = false;
+            resume = 0;
+        }
+        return !scavenged && erases != 0 && now - quiet_since >= min_idle;
+    }
+};
+
+void print_pool_stats(const char* name, const any_pool& p) {
+    pool_stats s = p.stats();
+    std::cout << "[" << name << "] live " << s.live << ", slots " << s.slots << ", capacity " << s.capacity
+              << ", free " << s.free_slots << ", blocks " << s.blocks << ", " << s.element_size << " bytes each, "
+              << s.committed_bytes / (1024.0 * 1024.0) << " MB committed";
+    if (s.decommitted_bytes) std::cout << ", " << s.decommitted_bytes / (1024.0 * 1024.0) << " MB decommitted";
+    if (s.realtime_violations) std::cout << ", " << s.realtime_violations << " real-time violations";
+    if (s.claimed_slots) std::cout << ", " << s.claimed_slots << " claimed";
+    if (s.leased_slots) std::cout << ", " << s.leased_slots << " leased or cached";
+    if (s.growth_limit) std::cout << ", " << s.grows << " grows, last block " << s.growth_block << " (" << s.growth_limit << ")";
+    if (s.locked_bytes || s.lock_failures) {
+        std::cout << ", " << s.locked_bytes / (1024.0 * 1024.0) << " MB locked, " << s.lock_failures << " lock failures";
+    }
+    std::cout << "\n";
+}
+
+// Occupancy bitmap kernels: bit i % 64 of words[i / 64] is set when slot i is alive.
+// Every variant computes the same results; occupancy_kernels() picks the widest one
+// the CPU supports (CPUID, checked once) and the portable loop is the fallback.
+struct occupancy_kernel_set {
+    const char* name;
+    size_t (*popcount)(const uint64_t* words, size_t n);
+    // Bit index of the first set bit of words[i] ^ invert, any_pool::npos if none;
+    // invert = ~0 finds the first clear bit
+    size_t (*find_first)(const uint64_t* words, size_t n, uint64_t invert);
+    // dst = a & b, returns popcount(dst); dst may alias a or b
+    size_t (*and_count)(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n);
+};
+
+static size_t occupancy_popcount_portable(const uint64_t* words, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) count += __builtin_popcountll(words[i]);
+    return count;
+}
+static size_t occupancy_find_first_portable(const uint64_t* words, size_t n, uint64_t invert) {
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t w = words[i] ^ invert;
+        if (w) return i * 64 + __builtin_ctzll(w);
+    }
+    return any_pool::npos;
+}
+static size_t occupancy_and_count_portable(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = a[i] & b[i];
+        count += __builtin_popcountll(dst[i]);
+    }
+    return count;
+}
+
+#ifdef POOL_X86_KERNELS
+// SSE4.2: the same loops with the POPCNT instruction instead of the generic
+// bit-twiddling __builtin_popcountll compiles to; find_first skips zero pairs with PTEST
+__attribute__((target("sse4.2,popcnt")))
+static size_t occupancy_popcount_sse42(const uint64_t* words, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) count += _mm_popcnt_u64(words[i]);
+    return count;
+}
+__attribute__((target("sse4.2,popcnt")))
+static size_t occupancy_find_first_sse42(const uint64_t* words, size_t n, uint64_t invert) {
+    const __m128i inv = _mm_set1_epi64x(static_cast<long long>(invert));
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i)), inv);
+        if (!_mm_testz_si128(v, v)) break;
+    }
+    for (; i < n; ++i) {
+        uint64_t w = words[i] ^ invert;
+        if (w) return i * 64 + __builtin_ctzll(w);
+    }
+    return any_pool::npos;
+}
+__attribute__((target("sse4.2,popcnt")))
+static size_t occupancy_and_count_sse42(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = a[i] & b[i];
+        count += _mm_popcnt_u64(dst[i]);
+    }
+    return count;
+}
+
+// AVX2 has no vector popcount: count nibbles with a PSHUFB lookup, sum bytes with PSADBW
+__attribute__((target("avx2,popcnt")))
+static inline __m256i popcount_epi64_avx2(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_nibble));
+    __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+__attribute__((target("avx2,popcnt")))
+static inline size_t sum_epi64_avx2(__m256i v) {
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return static_cast<size_t>(_mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1));
+}
+__attribute__((target("avx2,popcnt")))
+static size_t occupancy_popcount_avx2(const uint64_t* words, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_epi64(acc, popcount_epi64_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i))));
+    }
+    size_t count = sum_epi64_avx2(acc);
+    for (; i < n; ++i) count += _mm_popcnt_u64(words[i]);
+    return count;
+}
+__attribute__((target("avx2,popcnt")))
+static size_t occupancy_find_first_avx2(const uint64_t* words, size_t n, uint64_t invert) {
+    const __m256i inv = _mm256_set1_epi64x(static_cast<long long>(invert));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i)), inv);
+        if (!_mm256_testz_si256(v, v)) break;
+    }
+    for (; i < n; ++i) {
+        uint64_t w = words[i] ^ invert;
+        if (w) return i * 64 + __builtin_ctzll(w);
+    }
+    return any_pool::npos;
+}
+__attribute__((target("avx2,popcnt")))
+static size_t occupancy_and_count_avx2(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+        acc = _mm256_add_epi64(acc, popcount_epi64_avx2(v));
+    }
+    size_t count = sum_epi64_avx2(acc);
+    for (; i < n; ++i) {
+        dst[i] = a[i] & b[i];
+        count += _mm_popcnt_u64(dst[i]);
+    }
+    return count;
+}
+
+// AVX-512: the same lookup 64 bytes at a time (AVX512BW; VPOPCNTQ needs the
+// separate VPOPCNTDQ extension), test masks pick the first non-zero word directly
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static inline __m512i popcount_epi64_avx512(__m512i v) {
+    // Nibble popcounts 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4 in every 16-byte lane
+    const __m512i lookup = _mm512_set_epi64(0x0403030203020201, 0x0302020102010100, 0x0403030203020201, 0x0302020102010100,
+                                            0x0403030203020201, 0x0302020102010100, 0x0403030203020201, 0x0302020102010100);
+    const __m512i low_nibble = _mm512_set1_epi8(0x0f);
+    __m512i lo = _mm512_shuffle_epi8(lookup, _mm512_and_si512(v, low_nibble));
+    __m512i hi = _mm512_shuffle_epi8(lookup, _mm512_and_si512(_mm512_srli_epi16(v, 4), low_nibble));
+    return _mm512_sad_epu8(_mm512_add_epi8(lo, hi), _mm512_setzero_si512());
+}
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static inline size_t sum_epi64_avx512(__m512i v) {
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+}
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static size_t occupancy_popcount_avx512(const uint64_t* words, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) acc = _mm512_add_epi64(acc, popcount_epi64_avx512(_mm512_loadu_si512(words + i)));
+    size_t count = sum_epi64_avx512(acc);
+    for (; i < n; ++i) count += _mm_popcnt_u64(words[i]);
+    return count;
+}
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static size_t occupancy_find_first_avx512(const uint64_t* words, size_t n, uint64_t invert) {
+    const __m512i inv = _mm512_set1_epi64(static_cast<long long>(invert));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i v = _mm512_xor_si512(_mm512_loadu_si512(words + i), inv);
+        __mmask8 nonzero = _mm512_test_epi64_mask(v, v);
+        if (nonzero) {
+            size_t w = i + __builtin_ctz(nonzero);
+            return w * 64 + __builtin_ctzll(words[w] ^ invert);
+        }
+    }
+    for (; i < n; ++i) {
+        uint64_t w = words[i] ^ invert;
+        if (w) return i * 64 + __builtin_ctzll(w);
+    }
+    return any_pool::npos;
+}
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static size_t occupancy_and_count_avx512(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i v = _mm512_and_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        _mm512_storeu_si512(dst + i, v);
+        acc = _mm512_add_epi64(acc, popcount_epi64_avx512(v));
+    }
+    size_t count = sum_epi64_avx512(acc);
+    for (; i < n; ++i) {
+        dst[i] = a[i] & b[i];
+        count += _mm_popcnt_u64(dst[i]);
+    }
+    return count;
+}
+#endif
+
+// Variants this CPU can run, narrowest first (the benchmark compares them all)
+std::vector<occupancy_kernel_set> occupancy_kernel_variants() {
+    std::vector<occupancy_kernel_set> variants{
+        {"portable", occupancy_popcount_portable, occupancy_find_first_portable, occupancy_and_count_portable}};
+#ifdef POOL_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+        variants.push_back({"sse4.2", occupancy_popcount_sse42, occupancy_find_first_sse42, occupancy_and_count_sse42});
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        variants.push_back({"avx2", occupancy_popcount_avx2, occupancy_find_first_avx2, occupancy_and_count_avx2});
+    }
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        variants.push_back({"avx512", occupancy_popcount_avx512, occupancy_find_first_avx512, occupancy_and_count_avx512});
+    }
+#endif
+    return variants;
+}
+const occupancy_kernel_set& occupancy_kernels() {
+    static const occupancy_kernel_set selected = occupancy_kernel_variants().back();
+    return selected;
+}
 
 // Pool class: vector-like, supports push_back and operator[]
 // Dynamically allocates new memory blocks when needed
 
+// Tenant tag for pool::emplace_tagged; 0 marks untagged objects, which are not accounted
+using pool_tag = uint16_t;
+
+struct tag_usage {
+    size_t live = 0;        // objects carrying the tag
+    size_t bytes = 0;       // live * slot size
+    size_t quota_bytes = 0; // 0: no quota
+};
+
+// Runs fn(begin, end) over [0, n) split into one chunk per hardware thread, with at
+// least min_chunk items per chunk; the calling thread takes the first chunk
+template<typename Fn>
+void parallel_chunks(size_t n, size_t min_chunk, Fn&& fn) {
+    size_t threads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), n / min_chunk));
+    size_t chunk = (n + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t) {
+        workers.emplace_back([&fn, t, chunk, n] { fn(t * chunk, std::min(n, (t + 1) * chunk)); });
+    }
+    fn(0, std::min(n, chunk));
+    for (auto& worker : workers) worker.join();
+}
+
+// Sorts one run per thread, then merges neighbouring runs pairwise (in parallel) until one is left
+template<typename It, typename Cmp>
+void parallel_sort(It first, It last, Cmp cmp) {
+    size_t n = static_cast<size_t>(last - first);
+    std::vector<size_t> bounds{0};
+    parallel_chunks(n, 1 << 16, [&](size_t b, size_t e) { std::sort(first + b, first + e, cmp); });
+    size_t threads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), n / (1 << 16)));
+    size_t chunk = (n + threads - 1) / threads;
+    for (size_t t = 1; t <= threads; ++t) bounds.push_back(std::min(n, t * chunk));
+    while (bounds.size() > 2) {
+        std::vector<size_t> merged{0};
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+            if (i + 2 < bounds.size()) {
+                size_t b = bounds[i], m = bounds[i + 1], e = bounds[i + 2];
+                workers.emplace_back([=] { std::inplace_merge(first + b, first + m, first + e, cmp); });
+            }
+            merged.push_back(bounds[std::min(i + 2, bounds.size() - 1)]);
+        }
+        for (auto& worker : workers) worker.join();
+        bounds.swap(merged);
+    }
+}
+
+// Pooled object passed between threads by address (see spsc_queue): 8 bytes in
+// place of a copy, valid until the owner erases the object
 template<typename T>
-class pool {
-    // Calculate padding so that sizeof(Element) is a multiple of 64
-    static constexpr size_t element_padding = (64 - (sizeof(T) % 64)) % 64;
+struct pool_handle {
+    T* object = nullptr;
+    T* operator->() const { return object; }
+    T& operator*() const { return *object; }
+};
+
+// Contiguous run of uninitialized slots from pool::claim(). The producer constructs
+// objects at place(0..size-1) (consecutive addresses, stride bytes apart), then
+// passes the claim to pool::publish()
+template<typename T>
+struct pool_claim {
+    size_t first = 0;  // index of place(0)
+    size_t size = 0;
+    size_t stride = 0; // bytes between consecutive slots
+    char* data = nullptr;
+    void* place(size_t i) const { return data + i * stride; }
+};
+
+// Block size chosen by pool::grow(), see pool::set_growth_policy
+enum class growth_policy { doubling, fixed, adaptive };
+
+struct growth_decision {
+    size_t block_capacity = 0;         // slots of the block grow() added
+    double insert_rate = 0;            // per second since the previous decision
+    double erase_rate = 0;             // per second since the previous decision
+    size_t releases = 0;               // blocks released since the previous decision
+    const char* limited_by = nullptr;  // doubling, fixed; adaptive: rate, waste, churn, minimum; claim: raised to fit a claim()
+};
+
+template<typename T, typename Layout> class pool;
+
+// Move-only ownership of one object leased from a pool (pool::lease): the object is
+// destroyed and its slot goes back to the pool when the lease is destroyed or reset.
+// A lease must not outlive its pool.
+template<typename T, typename Layout = pool_layout<T>>
+class pool_lease {
+public:
+    pool_lease() = default;
+    pool_lease(pool_lease&& other) noexcept : owner(other.owner), slot(other.slot), object(other.object) {
+        other.owner = nullptr;
+        other.object = nullptr;
+    }
+    pool_lease& operator=(pool_lease&& other) noexcept {
+        if (this != &other) {
+            reset();
+            owner = other.owner;
+            slot = other.slot;
+            object = other.object;
+            other.owner = nullptr;
+            other.object = nullptr;
+        }
+        return *this;
+    }
+    pool_lease(const pool_lease&) = delete;
+    pool_lease& operator=(const pool_lease&) = delete;
+    ~pool_lease() { reset(); }
+    void reset() {
+        if (!object) return;
+        owner->return_lease(slot, object);
+        owner = nullptr;
+        object = nullptr;
+    }
+    T* get() const { return object; }
+    T& operator*() const { return *object; }
+    T* operator->() const { return object; }
+    explicit operator bool() const { return object != nullptr; }
+    size_t index() const { return slot; }
+private:
+    friend class pool<T, Layout>;
+    pool_lease(pool<T, Layout>* owner, size_t slot, T* object) : owner(owner), slot(slot), object(object) {}
+    pool<T, Layout>* owner = nullptr;
+    size_t slot = 0;
+    T* object = nullptr;
+};
+
+template<typename T, typename Layout = pool_layout<T>>
+class pool final : public any_pool {
+    // Layout::padding makes sizeof(Element) a multiple of 64 (plus coloring, see pool_layout)
     struct alignas(64) Element {
         T obj;
-        char padding[element_padding];
+        char padding[Layout::padding];
     };
+    static_assert(sizeof(Element) == Layout::stride, "Element must match the layout stride");
+    static constexpr bool tag_in_padding = Layout::padding >= sizeof(pool_tag);
 
 public:
-
+    static constexpr pool_tag untagged = 0;
 
     explicit pool(size_t initial_capacity)
-        : block_size(initial_capacity), count(0), total_capacity(initial_capacity) {
-        add_block(block_size);
+        : block_size(0), min_block(0), count(0), total_capacity(0), live(0) {
+        block_size = min_block = total_capacity = add_block(initial_capacity);
+        occupancy.resize((total_capacity + 63) / 64);
     }
+    pool(const pool&) = delete;
+    pool& operator=(const pool&) = delete;
     ~pool() {
+        if (lease_caches.load(std::memory_order_acquire)) {
+            lease_registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.m);
+            r.pools.erase(std::find(r.pools.begin(), r.pools.end(), this));
+        }
         for (size_t i = 0; i < object_ptrs.size(); ++i) {
             if (object_ptrs[i]) {
                 reinterpret_cast<T*>(object_ptrs[i])->~T();
             }
         }
+        disable_background_growth();
+        for (auto& block : blocks) {
+            unlock_block(block);
+            free_block(block.ptr, Layout::block_bytes(block.capacity));
+        }
+    }
+    // Locks every block in memory (mlock) as it is created, after touching its pages,
+    // and unlocks it when it is released. If mlock fails, e.g. RLIMIT_MEMLOCK is too low,
+    // the block stays unlocked but pre-touched and the failure is counted in stats.
+    void set_memory_lock(bool enabled) {
+        lock_memory = enabled;
+        for (auto& block : blocks) {
+            if (!block.ptr) continue;
+            if (enabled) {
+                lock_block(block);
+            } else {
+                unlock_block(block);
+            }
+        }
+    }
+    // Once count passes fill_threshold * capacity(), a helper thread allocates the next
+    // block (and with prefault touches its pages), so grow() only publishes a ready block.
+    // grow() never waits for the helper: if the block is not ready yet, it allocates one
+    // itself as without background growth.
+    void enable_background_growth(double fill_threshold, bool prefault) {
+        disable_background_growth();
+        prealloc.reset(new prealloc_state);
+        prealloc->threshold = fill_threshold;
+        prealloc->prefault = prefault;
+        prealloc->worker = std::thread([state = prealloc.get()] { run_prealloc(*state); });
+        prealloc_trigger = std::max(count + 1, static_cast<size_t>(total_capacity * fill_threshold));
+    }
+    void disable_background_growth() {
+        if (!prealloc) return;
+        {
+            std::lock_guard<std::mutex> lock(prealloc->m);
+            prealloc->stopping = true;
+        }
+        prealloc->cv.notify_all();
+        prealloc->worker.join();
+        if (prealloc->ready) free_block(prealloc->ready, Layout::block_bytes(prealloc->ready_capacity));
+        prealloc.reset();
+        prealloc_trigger = size_t(-1);
+        planned_growth = {};
+    }
+    // Block size for grow(): doubling (the default) doubles the last block, fixed repeats
+    // it. adaptive sizes it from what happened since the previous decision (made in
+    // grow(), or when background growth requests the next block): the block
+    // should last about target_interval at the net insert rate (inserts minus erases),
+    // which bounds how often the pool grows, but hold at most max_waste * live objects,
+    // which bounds the capacity left empty if inserts stop. If blocks were released
+    // meanwhile (emptied and allocated again), it is no smaller than the last block.
+    // Never below the initial capacity, and never below a claim() run that does not fit
+    // (limited_by "claim"); last_growth() and stats() report the decision.
+    void set_growth_policy(growth_policy policy,
+                           std::chrono::steady_clock::duration target_interval = std::chrono::milliseconds(10),
+                           double max_waste = 0.5) {
+        growth_mode = policy;
+        growth_interval = target_interval;
+        growth_max_waste = max_waste;
+    }
+    const growth_decision& last_growth() const { return last_decision; }
+    // Real-time configuration: reserves everything an operation could allocate, so from
+    // here on push_back/emplace/erase do no allocation and no system call, and cost O(1)
+    // (the block walk is bounded by the block count, which no longer changes).
+    // Pages are pre-faulted, empty blocks are kept, trim() and decommit_idle() do nothing.
+    // Whatever still allocates or is not O(1) (growing past reserved_capacity, a tag seen
+    // for the first time, the first lease, claim() of an empty block, compact(),
+    // reorder_by(), whose new block is pre-faulted too) is counted in realtime_violations
+    // and reported to on_violation.
+    void enable_realtime(size_t reserved_capacity, void (*on_violation)(const char* what) = nullptr) {
+        disable_background_growth();
+        if (total_capacity < reserved_capacity) {
+            size_t extra = add_block(reserved_capacity - total_capacity);
+            total_capacity += extra;
+            block_size = std::max(block_size, extra);
+            occupancy.resize((total_capacity + 63) / 64);
+        }
+        size_t base = 0;
         for (auto& block : blocks) {
-            ::operator delete[](block.ptr, std::align_val_t(64));
+            if (!block.ptr) {
+                // Как в revive_released_block: слоты ниже count снова в free_list
+                reallocate_block(block);
+                for (size_t i = std::min(base + block.capacity, count); i-- > base;) free_list.push_back(i);
+            }
+            pretouch(block.ptr, Layout::block_bytes(block.capacity));
+            base += block.capacity;
         }
+        // Grow and shrink back: the capacity stays and its pages are faulted in now
+        prefault_vector(object_ptrs, total_capacity);
+        prefault_vector(free_list, total_capacity);
+        if constexpr (!tag_in_padding) {
+            if (!tag_counts.empty()) prefault_vector(slot_tags, total_capacity);
+        }
+        realtime = true;
+        violation_handler = on_violation;
     }
     template<typename... Args>
     void push_back(Args&&... args) {
-        size_t insert_idx;
-        if (!free_list.empty()) {
-            insert_idx = free_list.back();
-            free_list.pop_back();
-            size_t block_idx, offset;
-            get_block_and_offset(insert_idx, block_idx, offset);
-            Element* element_place = reinterpret_cast<Element*>(static_cast<char*>(blocks[block_idx].ptr) + offset * sizeof(Element));
-            new (&(element_place->obj)) T(std::forward<Args>(args)...);
-            object_ptrs[insert_idx] = &(element_place->obj);
-            ++blocks[block_idx].refcount;
-        } else {
-            if (count == total_capacity) {
-                grow();
+        emplace(std::forward<Args>(args)...);
+    }
+    // Same as push_back, returns the slot index
+    template<typename... Args>
+    size_t emplace(Args&&... args) {
+        return construct_slot([&](void* place) { new (place) T(std::forward<Args>(args)...); });
+    }
+    // Default-initialization (new T, not new T()): trivially constructible members,
+    // e.g. a large char buffer, are left as they are instead of being zeroed
+    size_t emplace_default_init() {
+        return construct_slot([](void* place) { new (place) T; });
+    }
+    // emplace_default_init() restricted to trivially default constructible T: no
+    // constructor code runs at all, the caller fills the object through operator[]
+    size_t emplace_uninit() {
+        static_assert(std::is_trivially_default_constructible_v<T>, "emplace_uninit requires a trivially default constructible T");
+        return emplace_default_init();
+    }
+    // Per-tenant accounting: the tag is kept in the Element padding when there is room
+    // (a side array otherwise) and per-tag counts are maintained by emplace and erase,
+    // so usage() and the quota check are O(1)
+    template<typename... Args>
+    size_t emplace_tagged(pool_tag tag, Args&&... args) {
+        if (tag != untagged) {
+            if (tag >= tag_counts.size()) {
+                if (realtime) report_violation("new tag");
+                tag_counts.resize(size_t(tag) + 1);
             }
-            size_t block_idx, offset;
-            get_block_and_offset(count, block_idx, offset);
-            Element* element_place = reinterpret_cast<Element*>(static_cast<char*>(blocks[block_idx].ptr) + offset * sizeof(Element));
-            new (&(element_place->obj)) T(std::forward<Args>(args)...);
-            object_ptrs.push_back(&(element_place->obj));
-            ++blocks[block_idx].refcount;
-            ++count;
+            if (tag_counts[tag].quota != 0 && tag_counts[tag].live >= tag_counts[tag].quota) throw std::length_error("Tag quota exceeded");
+        }
+        size_t idx = construct_slot([&](void* place) { new (place) T(std::forward<Args>(args)...); }, tag);
+        if (tag != untagged) ++tag_counts[tag].live;
+        return idx;
+    }
+    // max_bytes is rounded down to whole slots; 0 removes the quota
+    void set_tag_quota(pool_tag tag, size_t max_bytes) {
+        if (tag == untagged) throw std::invalid_argument("Untagged objects have no quota");
+        if (tag >= tag_counts.size()) tag_counts.resize(size_t(tag) + 1);
+        tag_counts[tag].quota = max_bytes == 0 ? 0 : std::max<size_t>(max_bytes / sizeof(Element), 1);
+    }
+    tag_usage usage(pool_tag tag) const {
+        tag_usage u;
+        if (tag == untagged || tag >= tag_counts.size()) return u;
+        u.live = tag_counts[tag].live;
+        u.bytes = u.live * sizeof(Element);
+        u.quota_bytes = tag_counts[tag].quota * sizeof(Element);
+        return u;
+    }
+    // Producer-side batching: n consecutive slots within one block, taken from a block
+    // with no live objects or from the unused tail (growing if needed). Nothing is
+    // constructed and object_ptrs stay null until publish(), so the slots are not
+    // alive, but they are neither reused, decommitted nor released meanwhile.
+    // Slots skipped at the end of a block to keep the run contiguous go to the free list.
+    pool_claim<T> claim(size_t n) {
+        static_assert(Layout::contiguous, "claim requires a contiguous layout");
+        if (n == 0) throw std::invalid_argument("Empty claim");
+        size_t first = npos;
+        size_t base = 0;
+        for (size_t b = 0; b < blocks.size() && base + blocks[b].capacity <= count; base += blocks[b].capacity, ++b) {
+            if (blocks[b].refcount != 0 || blocks[b].capacity < n) continue;
+            if (blocks[b].ptr) {
+                // Проход по всему free_list — не O(1)
+                if (realtime) report_violation("claim of an empty block");
+                free_list.erase(std::remove_if(free_list.begin(), free_list.end(), [&](size_t i) {
+                    return i >= base && i < base + n;
+                }), free_list.end());
+            } else {
+                reallocate_block(blocks[b]);
+                for (size_t i = base + n; i < base + blocks[b].capacity; ++i) free_list.push_back(i);
+            }
+            first = base;
+            break;
+        }
+        if (first == npos) {
+            size_t old_count = count;
+            while (true) {
+                // Блок должен вместить весь диапазон, иначе fixed/adaptive растут бесконечно
+                if (count == total_capacity) grow(n);
+                size_t block_idx, offset;
+                get_block_and_offset(count, block_idx, offset);
+                size_t room = blocks[block_idx].capacity - offset;
+                if (room >= n) break;
+                // Хвост блока слишком мал для запрошенного диапазона
+                for (size_t i = count; i < count + room && blocks[block_idx].ptr; ++i) free_list.push_back(i);
+                count += room;
+            }
+            first = count;
+            count += n;
+            object_ptrs.resize(count, nullptr);
+            if (old_count < prealloc_trigger && count >= prealloc_trigger) request_prealloc();
         }
+        size_t block_idx, offset;
+        get_block_and_offset(first, block_idx, offset);
+        if (!blocks[block_idx].ptr) {
+            reallocate_block(blocks[block_idx]);
+        }
+        blocks[block_idx].refcount += n;
+        blocks[block_idx].claimed += n;
+        claimed_slots += n;
+        window.inserts += n;
+        for (size_t i = 0; i < n; ++i) unpoison_slot(slot_address(block_idx, offset + i));
+        return {first, n, sizeof(Element), reinterpret_cast<char*>(slot_address(block_idx, offset))};
+    }
+    // Makes the first `constructed` slots of the claim alive (untagged); the rest
+    // go to the free list. The claim is emptied.
+    void publish(pool_claim<T>& c, size_t constructed = npos) {
+        if (c.size == 0) return;
+        constructed = std::min(constructed, c.size);
+        size_t block_idx, offset;
+        get_block_and_offset(c.first, block_idx, offset);
+        for (size_t i = 0; i < constructed; ++i) {
+            Element* element_place = reinterpret_cast<Element*>(c.place(i));
+            store_tag(c.first + i, element_place, untagged);
+            object_ptrs[c.first + i] = &(element_place->obj);
+            set_alive_bit(c.first + i);
+        }
+        for (size_t i = constructed; i < c.size; ++i) {
+            poison_slot(reinterpret_cast<Element*>(c.place(i)));
+            free_list.push_back(c.first + i);
+        }
+        blocks[block_idx].refcount -= c.size - constructed;
+        blocks[block_idx].claimed -= c.size;
+        claimed_slots -= c.size;
+        live += constructed;
+        c = {};
+    }
+    // RAII temporaries: lease(args...) constructs an object owned by the returned
+    // pool_lease, destroyed and its slot reused when the lease goes away. Leased
+    // objects are not alive for index access (operator[], erase, for_each_alive), and
+    // compact()/reorder_by() refuse to run while slots are leased or cached.
+    // Free slots are cached per thread (for up to lease_threads threads at a time; a
+    // thread's caches are spilled and its cache id reused when it exits), so a lease and
+    // its return touch only that cache; refills and spills of half a cache take
+    // maintenance_mutex(). That makes leasing from several threads safe as long as
+    // every other mutation of the pool holds the same mutex.
+    template<typename... Args>
+    pool_lease<T, Layout> lease(Args&&... args) {
+        lease_slot slot = take_lease_slot();
+        try {
+            new (&(slot.place->obj)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            return_lease_slot(slot);
+            throw;
+        }
+        return pool_lease<T, Layout>(this, slot.index, &(slot.place->obj));
+    }
+    // Gives the slots cached by every thread back to the pool; call it only while no
+    // other thread is leasing or returning
+    void flush_lease_caches() {
+        lease_cache* caches = lease_caches.load(std::memory_order_acquire);
+        if (!caches) return;
+        std::lock_guard<std::mutex> lock(maintenance_mutex());
+        for (size_t t = 0; t < lease_threads; ++t) {
+            while (caches[t].count) unreserve_slot(caches[t].slots[--caches[t].count]);
+        }
+    }
+    // Slot index of an object of this pool (e.g. from a pool_handle), npos for other
+    // addresses; O(blocks)
+    size_t index_of(const T* obj) const {
+        const char* p = reinterpret_cast<const char*>(obj);
+        size_t base = 0;
+        for (auto& block : blocks) {
+            const char* begin = static_cast<const char*>(block.ptr);
+            if (begin && p >= begin && p < begin + Layout::block_bytes(block.capacity)) {
+                return base + Layout::slot_of(static_cast<size_t>(p - begin));
+            }
+            base += block.capacity;
+        }
+        return npos;
+    }
+    pool_handle<T> handle(size_t idx) { return {&(*this)[idx]}; }
+    // Occupancy queries work on a bit-per-slot bitmap with the widest SIMD kernel the
+    // CPU supports (occupancy_kernels()), instead of walking object_ptrs.
+    // Claimed but unpublished slots count as not alive.
+    size_t count_alive(size_t first, size_t last) const {
+        last = std::min(last, count);
+        if (first >= last) return 0;
+        size_t fw = first >> 6, lw = (last - 1) >> 6;
+        uint64_t head_mask = ~uint64_t(0) << (first & 63);
+        uint64_t tail_mask = ~uint64_t(0) >> (63 - ((last - 1) & 63));
+        if (fw == lw) return __builtin_popcountll(occupancy[fw] & head_mask & tail_mask);
+        return __builtin_popcountll(occupancy[fw] & head_mask) + __builtin_popcountll(occupancy[lw] & tail_mask)
+            + occupancy_kernels().popcount(occupancy.data() + fw + 1, lw - fw - 1);
+    }
+    // Next alive index / next index without an object (free, released or claimed), npos if none
+    size_t find_alive(size_t from) const { return find_bit(from, 0); }
+    size_t find_hole(size_t from) const { return find_bit(from, ~uint64_t(0)); }
+    // selected = alive & predicate (same bit-per-slot layout, indices past size() are ignored);
+    // returns the number of selected slots
+    size_t select_alive(const std::vector<uint64_t>& predicate, std::vector<uint64_t>& selected) const {
+        size_t n = std::min(predicate.size(), (count + 63) / 64);
+        selected.resize(n);
+        return occupancy_kernels().and_count(selected.data(), occupancy.data(), predicate.data(), n);
+    }
+    const std::vector<uint64_t>& occupancy_bitmap() const { return occupancy; }
+    pool_tag tag_of(size_t idx) const {
+        if (idx >= object_ptrs.size() || !object_ptrs[idx]) throw std::out_of_range("Index out of range or deleted");
+        return load_tag(idx);
     }
     T& operator[](size_t idx) {
         if (idx >= object_ptrs.size() || !object_ptrs[idx]) throw std::out_of_range("Index out of range or deleted");
@@ -72,36 +943,37 @@ public:
         if (idx >= object_ptrs.size() || !object_ptrs[idx]) throw std::out_of_range("Index out of range or deleted");
         return *reinterpret_cast<T*>(object_ptrs[idx]);
     }
+    // Slots in use or freed below the high-water mark: indices are < size()
     size_t size() const { return count; }
+    size_t live_count() const { return live; }
     size_t capacity() const { return total_capacity; }
 public:
 
-    void erase(size_t idx) {
-        if (idx >= object_ptrs.size() || !object_ptrs[idx]) throw std::out_of_range("Index out of range or already deleted");
+    void erase(size_t idx) override {
+        // Liveness from the occupancy bitmap and the address from the block: erase does
+        // not wait for an object_ptrs load, only stores to it
+        if (idx >= object_ptrs.size() || !(occupancy[idx >> 6] >> (idx & 63) & 1)) throw std::out_of_range("Index out of range or already deleted");
         // Найти блок и offset
         size_t block_idx, offset;
         get_block_and_offset(idx, block_idx, offset);
-        reinterpret_cast<T*>(object_ptrs[idx])->~T();
+        Element* element_place = slot_address(block_idx, offset);
+        pool_tag tag = load_tag(idx, element_place);
+        element_place->obj.~T();
+        poison_slot(element_place);
         object_ptrs[idx] = nullptr;
+        clear_alive_bit(idx);
         free_list.push_back(idx);
         --blocks[block_idx].refcount;
+        ++blocks[block_idx].idle.erases;
+        ++window.erases;
+        --live;
+        if (tag != untagged) --tag_counts[tag].live;
         // Если блок полностью пуст — освободить
-        if (blocks[block_idx].refcount == 0) {
-            // Удалить все object_ptrs и free_list, относящиеся к этому блоку
-            size_t base = 0;
-            for (size_t i = 0; i < block_idx; ++i) base += blocks[i].capacity;
-            for (size_t j = 0; j < blocks[block_idx].capacity; ++j) {
-                size_t abs_idx = base + j;
-                if (abs_idx < object_ptrs.size()) object_ptrs[abs_idx] = nullptr;
-            }
-            free_list.erase(std::remove_if(free_list.begin(), free_list.end(), [&](size_t i) {
-                return (i >= base && i < base + blocks[block_idx].capacity);
-            }), free_list.end());
-            ::operator delete[](blocks[block_idx].ptr, std::align_val_t(64));
-            blocks[block_idx].ptr = nullptr;
-        }
-    }
-    bool is_alive(size_t idx) const {
+        if (blocks[block_idx].refcount == 0 && !realtime) {
+            release_block(block_idx);
+        }
+    }
+    bool is_alive(size_t idx) const override {
         return idx < object_ptrs.size() && object_ptrs[idx];
     }
     // Итерация по живым объектам без классов
@@ -111,59 +983,2383 @@ public:
             if (object_ptrs[i]) f(*reinterpret_cast<T*>(object_ptrs[i]), i);
         }
     }
+
+    // any_pool
+    pool_stats stats() const override {
+        pool_stats s;
+        s.live = live;
+        s.slots = object_ptrs.size();
+        s.capacity = total_capacity;
+        s.free_slots = free_list.size();
+        s.element_size = sizeof(Element);
+        for (auto& block : blocks) {
+            if (!block.ptr) continue;
+            ++s.blocks;
+            s.committed_bytes += Layout::block_bytes(block.capacity);
+        }
+        s.decommitted_bytes = decommitted;
+        s.realtime_violations = realtime_violations;
+        s.locked_bytes = locked_bytes;
+        s.lock_failures = lock_failures;
+        s.claimed_slots = claimed_slots;
+        s.leased_slots = leased_slots;
+        s.grows = grows;
+        if (growth_mode == growth_policy::adaptive && grows) {
+            s.growth_block = last_decision.block_capacity;
+            s.growth_limit = last_decision.limited_by;
+        }
+        return s;
+    }
+    size_t trim() override {
+        if (realtime) return 0;
+        // Пустыми бывают только блоки за count: выросли, но ещё не использовались
+        size_t released = 0;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (blocks[i].ptr && blocks[i].refcount == 0) {
+                released += Layout::block_bytes(blocks[i].capacity);
+                release_block(i);
+            }
+        }
+        return released;
+    }
+    size_t compact(std::vector<size_t>* remap) override {
+        // Занятые claim() слоты выглядят как дыры — переносить в них нельзя
+        if (claimed_slots) throw std::logic_error("Cannot compact while claimed slots are unpublished");
+        if (leased_slots) throw std::logic_error("Cannot compact while slots are leased or cached for leases");
+        if (handles_in_flight()) throw std::logic_error("Cannot compact while handles are in flight");
+        if (realtime) report_violation("compact");
+        if (remap) {
+            remap->assign(object_ptrs.size(), npos);
+            for (size_t i = 0; i < object_ptrs.size(); ++i) {
+                if (object_ptrs[i]) (*remap)[i] = i;
+            }
+        }
+        if constexpr (!std::is_move_constructible_v<T>) {
+            return 0;
+        } else {
+            size_t moved = 0;
+            size_t lo = 0, hi = object_ptrs.size();
+            while (true) {
+                // lo — первая дыра в выделенном блоке, hi - 1 — последний живой объект
+                while (lo < hi && (object_ptrs[lo] || !slot_allocated(lo))) ++lo;
+                while (hi > lo && !object_ptrs[hi - 1]) --hi;
+                if (lo + 1 >= hi) break;
+                size_t src = hi - 1;
+                size_t dst_block, dst_offset, src_block, src_offset;
+                get_block_and_offset(lo, dst_block, dst_offset);
+                get_block_and_offset(src, src_block, src_offset);
+                T* from = reinterpret_cast<T*>(object_ptrs[src]);
+                Element* element_place = slot_address(dst_block, dst_offset);
+                unpoison_slot(element_place);
+                new (&(element_place->obj)) T(std::move(*from));
+                pool_tag tag = load_tag(src);
+                from->~T();
+                poison_slot(reinterpret_cast<Element*>(from));
+                store_tag(lo, element_place, tag);
+                object_ptrs[lo] = &(element_place->obj);
+                object_ptrs[src] = nullptr;
+                set_alive_bit(lo);
+                clear_alive_bit(src);
+                ++blocks[dst_block].refcount;
+                --blocks[src_block].refcount;
+                if (remap) {
+                    (*remap)[src] = lo;
+                }
+                ++moved;
+                --hi;
+            }
+            // Хвост без живых объектов снова доступен для push_back
+            while (hi > 0 && !object_ptrs[hi - 1]) --hi;
+            object_ptrs.resize(hi);
+            count = hi;
+            free_list.clear();
+            for (size_t i = 0; i < hi; ++i) {
+                if (!object_ptrs[i] && slot_allocated(i)) free_list.push_back(i);
+            }
+            return moved;
+        }
+    }
+    // Batched field updates: out[i] = obj(indices[i]).*member for gather, the reverse
+    // for scatter. Objects are addressed from their block and prefetched ahead of use
+    // (see for_each_in_batch), so the cache misses of a batch overlap instead of
+    // following a dependent object_ptrs load each, as in an operator[] loop.
+    // All indices are checked before anything is read or written; with duplicate
+    // indices in a scatter, the last value wins.
+    template<typename V>
+    void scatter(const std::vector<size_t>& indices, const std::vector<V>& values, V T::*member) {
+        if (indices.size() != values.size()) throw std::invalid_argument("scatter: indices and values differ in size");
+        for_each_in_batch(indices, [&](size_t i) -> const V& { return values[i]; }, [&](T* obj, const V& value) { obj->*member = value; });
+    }
+    template<typename V>
+    void gather(const std::vector<size_t>& indices, V T::*member, std::vector<V>& out) const {
+        out.resize(indices.size());
+        for_each_in_batch(indices, [](size_t i) { return i; }, [&](const T* obj, size_t i) { out[i] = obj->*member; });
+    }
+    // Moves live objects into one new block in ascending key_fn(obj) order (ties keep
+    // index order), so scans in key order touch memory sequentially. Keys are sorted on
+    // all hardware threads; trivially copyable objects are relocated by memcpy in
+    // parallel, others are move-constructed. The old blocks are freed and index i of
+    // the result is the i-th object in key order; remap (if given) maps old index to
+    // new, npos for dead slots. Returns the number of objects relocated.
+    template<typename KeyFn>
+    size_t reorder_by(KeyFn key_fn, std::vector<size_t>* remap = nullptr) {
+        static_assert(std::is_move_constructible_v<T>, "reorder_by requires a move constructible T");
+        if (claimed_slots) throw std::logic_error("Cannot reorder while claimed slots are unpublished");
+        if (leased_slots) throw std::logic_error("Cannot reorder while slots are leased or cached for leases");
+        if (handles_in_flight()) throw std::logic_error("Cannot reorder while handles are in flight");
+        if (realtime) report_violation("reorder");
+        using Key = std::decay_t<decltype(key_fn(std::declval<const T&>()))>;
+        std::vector<std::pair<Key, size_t>> order;
+        order.reserve(live);
+        for (size_t i = 0; i < object_ptrs.size(); ++i) {
+            if (object_ptrs[i]) order.emplace_back(key_fn(*reinterpret_cast<const T*>(object_ptrs[i])), i);
+        }
+        parallel_sort(order.begin(), order.end(), [](const std::pair<Key, size_t>& a, const std::pair<Key, size_t>& b) {
+            return a.first < b.first || (!(b.first < a.first) && a.second < b.second);
+        });
+
+        BlockInfo target{allocate_block(total_capacity), total_capacity, order.size(), {}};
+        if (realtime) pretouch(target.ptr, Layout::block_bytes(target.capacity));
+        auto place = [&](size_t i) {
+            return reinterpret_cast<Element*>(static_cast<char*>(target.ptr) + Layout::offset_of(i));
+        };
+        std::vector<pool_tag> new_tags;
+        if constexpr (!tag_in_padding) {
+            if (!slot_tags.empty()) new_tags.resize(order.size(), untagged);
+        }
+        auto relocate = [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; ++i) {
+                size_t src = order[i].second;
+                unpoison_slot(place(i));
+                if constexpr (std::is_trivially_copyable_v<T>) {
+                    // Padding (and the tag in it) moves with the object
+                    std::memcpy(place(i), reinterpret_cast<Element*>(object_ptrs[src]), sizeof(Element));
+                } else {
+                    T* from = reinterpret_cast<T*>(object_ptrs[src]);
+                    new (&(place(i)->obj)) T(std::move(*from));
+                    from->~T();
+                    if constexpr (tag_in_padding) store_tag(i, place(i), load_tag(src));
+                }
+                if constexpr (!tag_in_padding) {
+                    if (!new_tags.empty()) new_tags[i] = src < slot_tags.size() ? slot_tags[src] : untagged;
+                }
+            }
+        };
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            parallel_chunks(order.size(), 1 << 14, relocate);
+        } else {
+            relocate(0, order.size());
+        }
+
+        if (remap) {
+            remap->assign(object_ptrs.size(), npos);
+            for (size_t i = 0; i < order.size(); ++i) (*remap)[order[i].second] = i;
+        }
+        for (auto& block : blocks) {
+            if (!block.ptr) continue;
+            unlock_block(block);
+            free_block(block.ptr, Layout::block_bytes(block.capacity));
+        }
+        blocks.clear();
+        released_blocks = 0;
+        first_released = npos;
+        blocks.push_back(target);
+        lock_block(blocks.back());
+        block_size = total_capacity;
+        count = order.size();
+        object_ptrs.resize(count);
+        for (size_t i = 0; i < count; ++i) object_ptrs[i] = &(place(i)->obj);
+        free_list.clear();
+        if constexpr (!tag_in_padding) slot_tags.swap(new_tags);
+        std::fill(occupancy.begin(), occupancy.end(), 0);
+        for (size_t i = 0; i < count; ++i) set_alive_bit(i);
+        if (prealloc) prealloc_trigger = std::max(count + 1, static_cast<size_t>(total_capacity * prealloc->threshold));
+        return count;
+    }
+    pool_snapshot snapshot() const override {
+        pool_snapshot snap;
+        snap.element_size = sizeof(T);
+        snap.has_bytes = std::is_trivially_copyable_v<T>;
+        for (size_t i = 0; i < object_ptrs.size(); ++i) {
+            if (!object_ptrs[i]) continue;
+            snap.indices.push_back(i);
+            if (snap.has_bytes) {
+                const unsigned char* bytes = static_cast<const unsigned char*>(object_ptrs[i]);
+                snap.bytes.insert(snap.bytes.end(), bytes, bytes + sizeof(T));
+            }
+        }
+        return snap;
+    }
+    void visit_slots(const std::function<void(const raw_slot&)>& f) override {
+        for (size_t i = 0; i < object_ptrs.size(); ++i) {
+            if (object_ptrs[i]) f(raw_slot{object_ptrs[i], i, sizeof(T), &destroy_object});
+        }
+    }
+    size_t decommit_idle(std::chrono::steady_clock::duration min_idle, size_t max_bytes) override {
+        if (realtime) return 0;
+        auto now = std::chrono::steady_clock::now();
+        size_t released = 0;
+        size_t base = 0;
+        for (auto& block : blocks) {
+            if (block.ptr && block.claimed == 0 && released < max_bytes && block.idle.ready(now, min_idle)) {
+                size_t used = object_ptrs.size() > base ? std::min(block.capacity, object_ptrs.size() - base) : 0;
+                released += decommit_free_slots<Layout>(static_cast<char*>(block.ptr), used,
+                    [&](size_t j) { return !object_ptrs[base + j]; }, max_bytes - released, block.idle.resume);
+                block.idle.scavenged = block.idle.resume == 0;
+            }
+            base += block.capacity;
+        }
+        decommitted += released;
+        return released;
+    }
 private:
     struct BlockInfo {
         void* ptr;
         size_t capacity;
         size_t refcount;
+        idle_tracker idle;
+        bool locked = false;
+        size_t claimed = 0; // claim() slots not yet published and lease slots, counted in refcount too
+    };
+    // Background growth: the helper only touches prealloc_state, under its mutex
+    struct prealloc_state {
+        std::thread worker;
+        std::mutex m;
+        std::condition_variable cv;
+        size_t requested = 0;  // capacity of the next block to allocate, 0: nothing to do
+        void* ready = nullptr; // allocated block waiting for grow()
+        size_t ready_capacity = 0;
+        bool stopping = false;
+        bool prefault = false;
+        double threshold = 0.0;
     };
     std::vector<BlockInfo> blocks;
     std::vector<void*> object_ptrs;
     std::vector<size_t> free_list;
     size_t block_size;
+    size_t min_block; // initial capacity, the smallest block adaptive growth picks
     size_t count;
     size_t total_capacity;
+    size_t live;
+    size_t decommitted = 0;
+    struct tag_count {
+        size_t live = 0;
+        size_t quota = 0; // in objects, 0: none
+    };
+    std::vector<uint64_t> occupancy;   // bit per slot, set while object_ptrs[i] is non-null
+    std::vector<tag_count> tag_counts; // indexed by tag
+    // Per slot, only when the tag does not fit in the padding. Created by the first tagged
+    // object and never longer than the last tagged slot: slots past its end are untagged.
+    std::vector<pool_tag> slot_tags;
+    std::unique_ptr<prealloc_state> prealloc;
+    size_t prealloc_trigger = size_t(-1); // count at which the next block is requested
+    bool realtime = false;
+    size_t realtime_violations = 0;
+    bool lock_memory = false;
+    size_t locked_bytes = 0;
+    size_t lock_failures = 0;
+    size_t claimed_slots = 0;
+    size_t released_blocks = 0; // blocks whose memory was freed by erase or trim
+    size_t first_released = npos; // every block below it is allocated
+    // Growth policy state: activity since the previous decision feeds plan_growth()
+    struct growth_window {
+        size_t inserts = 0;
+        size_t erases = 0;
+        size_t releases = 0;
+        std::chrono::steady_clock::time_point since = std::chrono::steady_clock::now();
+    };
+    growth_policy growth_mode = growth_policy::doubling;
+    std::chrono::steady_clock::duration growth_interval{};
+    double growth_max_waste = 0.5;
+    growth_window window;
+    growth_decision last_decision;
+    growth_decision planned_growth; // chosen when background growth was requested
+    size_t grows = 0;
+    void (*violation_handler)(const char*) = nullptr;
 
-    void add_block(size_t block_capacity) {
-        auto t1 = std::chrono::high_resolution_clock::now();
-        void* mem = ::operator new[](block_capacity * sizeof(Element), std::align_val_t(64));
-        auto t2 = std::chrono::high_resolution_clock::now();
-        blocks.push_back({mem, block_capacity, 0});
-        auto ms = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
-        std::cout << "[pool] Allocated block for " << block_capacity << " objects (" << sizeof(Element) << " bytes each, aligned to 64) in " << ms << " microseconds\n";
-    }
-    void grow() {
-        size_t new_block_size = block_size * 2;
-        add_block(new_block_size);
-        total_capacity += new_block_size;
-        block_size = new_block_size;
+    friend class pool_lease<T, Layout>;
+    static constexpr size_t lease_threads = 64;
+    static constexpr size_t lease_cache_size = 32;
+    struct lease_slot {
+        size_t index;
+        Element* place;
+    };
+    struct alignas(64) lease_cache {
+        size_t count = 0;
+        lease_slot slots[lease_cache_size];
+    };
+    std::unique_ptr<lease_cache[]> lease_cache_storage; // lease_threads caches, made by the first lease
+    std::atomic<lease_cache*> lease_caches{nullptr};
+    size_t leased_slots = 0; // reserved for leases: cached or holding a leased object
+
+    // Cache ids are shared by all pools of this type: a thread takes the lowest free
+    // one on its first lease (none while lease_threads threads hold one, it then leases
+    // through the mutex) and gives it back when it exits, after spilling its cache in
+    // every pool of the type that still exists
+    static_assert(lease_threads == 64, "lease cache ids are a 64-bit mask");
+    struct lease_registry {
+        std::mutex m; // taken before any pool's maintenance_mutex()
+        uint64_t used_ids = 0;
+        std::vector<pool*> pools; // pools whose lease caches exist
+    };
+    static lease_registry& registry() {
+        static lease_registry r;
+        return r;
     }
-    void get_block_and_offset(size_t global_idx, size_t& block_idx, size_t& offset) const {
-        size_t idx = global_idx;
-        for (size_t i = 0; i < blocks.size(); ++i) {
-            if (idx < blocks[i].capacity) {
-                block_idx = i;
-                offset = idx;
-                return;
+    struct lease_thread {
+        size_t id = npos;
+        lease_thread() {
+            lease_registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.m);
+            if (~r.used_ids) {
+                id = __builtin_ctzll(~r.used_ids);
+                r.used_ids |= uint64_t(1) << id;
             }
-            idx -= blocks[i].capacity;
         }
-        throw std::out_of_range("Internal pool index error");
+        ~lease_thread() {
+            if (id == npos) return;
+            lease_registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.m);
+            for (pool* p : r.pools) p->spill_lease_cache(id);
+            r.used_ids &= ~(uint64_t(1) << id);
+        }
+    };
+    // The owner has a destructor, so every access to it checks its TLS guard; the id
+    // is copied to a constant-initialized thread_local for the fast path
+    static constexpr size_t unassigned_lease_id = npos - 1;
+    static size_t lease_thread_id() {
+        static thread_local size_t id = unassigned_lease_id;
+        if (id == unassigned_lease_id) id = lease_thread_owner_id();
+        return id;
     }
-
-};
-
-class MyClass {
-    char data[4096]; // 4 KB per object
-    std::string info;
-public:
-    MyClass(int x_, const std::string& s) : info(s) {
-        data[0] = static_cast<char>(x_); // just to use x_
-        // std::cout << "Constructed: " << info << "\n";
+    static size_t lease_thread_owner_id() {
+        thread_local lease_thread thread;
+        return thread.id;
+    }
+    // Fast path only; the first lease of the pool and of the thread go out of line
+    lease_cache* lease_cache_for_thread() {
+        size_t id = lease_thread_id();
+        if (id == npos) return nullptr;
+        lease_cache* caches = lease_caches.load(std::memory_order_acquire);
+        if (!caches) caches = create_lease_caches();
+        return &caches[id];
+    }
+    lease_cache* create_lease_caches() {
+        lease_registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.m);
+        lease_cache* caches = lease_caches.load(std::memory_order_relaxed);
+        if (!caches) {
+            if (realtime) report_violation("lease caches");
+            lease_cache_storage.reset(new lease_cache[lease_threads]);
+            caches = lease_cache_storage.get();
+            r.pools.push_back(this);
+            lease_caches.store(caches, std::memory_order_release);
+        }
+        return caches;
+    }
+    void spill_lease_cache(size_t id) {
+        lease_cache& cache = lease_cache_storage[id];
+        if (!cache.count) return;
+        std::lock_guard<std::mutex> lock(maintenance_mutex());
+        while (cache.count) unreserve_slot(cache.slots[--cache.count]);
+    }
+    lease_slot take_lease_slot() {
+        lease_cache* cache = lease_cache_for_thread();
+        if (cache && cache->count) {
+            lease_slot slot = cache->slots[--cache->count];
+            unpoison_slot(slot.place);
+            return slot;
+        }
+        std::lock_guard<std::mutex> lock(maintenance_mutex());
+        if (cache) {
+            while (cache->count < lease_cache_size / 2) {
+                lease_slot slot = reserve_slot();
+                poison_slot(slot.place);
+                cache->slots[cache->count++] = slot;
+            }
+        }
+        return reserve_slot();
+    }
+    void return_lease(size_t index, T* object) {
+        object->~T();
+        return_lease_slot({index, reinterpret_cast<Element*>(object)});
+    }
+    void return_lease_slot(lease_slot slot) {
+        poison_slot(slot.place);
+        lease_cache* cache = lease_cache_for_thread();
+        if (cache && cache->count < lease_cache_size) {
+            cache->slots[cache->count++] = slot;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(maintenance_mutex());
+        unreserve_slot(slot);
+        if (cache) {
+            while (cache->count > lease_cache_size / 2) unreserve_slot(cache->slots[--cache->count]);
+        }
+    }
+    // Leased slots are counted like claim() slots: in refcount and BlockInfo::claimed
+    lease_slot reserve_slot() {
+        size_t idx, block_idx;
+        Element* place = take_slot(idx, block_idx);
+        ++blocks[block_idx].claimed;
+        ++leased_slots;
+        return {idx, place};
+    }
+    void unreserve_slot(lease_slot slot) {
+        size_t block_idx, offset;
+        get_block_and_offset(slot.index, block_idx, offset);
+        --blocks[block_idx].claimed;
+        --leased_slots;
+        free_list.push_back(slot.index);
+        --blocks[block_idx].refcount;
+        ++blocks[block_idx].idle.erases;
+        ++window.erases;
+        if (blocks[block_idx].refcount == 0 && !realtime) release_block(block_idx);
+    }
+    static void destroy_object(void* obj) { static_cast<T*>(obj)->~T(); }
+    template<typename Construct>
+    size_t construct_slot(Construct&& construct, pool_tag tag = untagged) {
+        size_t insert_idx, block_idx;
+        Element* element_place = take_slot(insert_idx, block_idx);
+        try {
+            construct(&(element_place->obj));
+        } catch (...) {
+            poison_slot(element_place);
+            free_list.push_back(insert_idx);
+            --blocks[block_idx].refcount;
+            // take_slot counted the insert after any plan_growth() reset, so this is >= 1
+            --window.inserts;
+            throw;
+        }
+        store_tag(insert_idx, element_place, tag);
+        object_ptrs[insert_idx] = &(element_place->obj);
+        set_alive_bit(insert_idx);
+        ++live;
+        return insert_idx;
+    }
+    // A free slot (free list first, then the end) counted in its block's refcount;
+    // object_ptrs covers it but stays null until the caller publishes an object
+    Element* take_slot(size_t& insert_idx, size_t& block_idx) {
+        // A full pool allocates a released block again before it grows
+        if (free_list.empty() && count == total_capacity && released_blocks != 0) revive_released_block();
+        size_t offset;
+        if (!free_list.empty()) {
+            insert_idx = free_list.back();
+            free_list.pop_back();
+            get_block_and_offset(insert_idx, block_idx, offset);
+        } else {
+            if (count == total_capacity) {
+                grow();
+            }
+            get_block_and_offset(count, block_idx, offset);
+            // Блок мог быть освобождён через erase или trim — выделить заново
+            if (!blocks[block_idx].ptr) {
+                reallocate_block(blocks[block_idx]);
+            }
+            object_ptrs.push_back(nullptr);
+            insert_idx = count++;
+            if (count == prealloc_trigger) request_prealloc();
+        }
+        ++blocks[block_idx].refcount;
+        ++window.inserts;
+        Element* element_place = slot_address(block_idx, offset);
+        unpoison_slot(element_place);
+        return element_place;
+    }
+    void store_tag(size_t idx, Element* element_place, pool_tag tag) {
+        if constexpr (tag_in_padding) {
+            (void)idx;
+            std::memcpy(element_place->padding, &tag, sizeof(tag));
+        } else {
+            (void)element_place;
+            if (idx >= slot_tags.size()) {
+                if (tag == untagged) return;
+                slot_tags.resize(idx + 1, untagged);
+            }
+            slot_tags[idx] = tag;
+        }
+    }
+    pool_tag load_tag(size_t idx) const {
+        return load_tag(idx, reinterpret_cast<const Element*>(object_ptrs[idx]));
+    }
+    pool_tag load_tag(size_t idx, const Element* element_place) const {
+        pool_tag tag;
+        if constexpr (tag_in_padding) {
+            (void)idx;
+            std::memcpy(&tag, element_place->padding, sizeof(tag));
+        } else {
+            (void)element_place;
+            tag = idx < slot_tags.size() ? slot_tags[idx] : untagged;
+        }
+        return tag;
+    }
+    Element* slot_address(size_t block_idx, size_t offset) const {
+        return reinterpret_cast<Element*>(static_cast<char*>(blocks[block_idx].ptr) + Layout::offset_of(offset));
+    }
+    void* allocate_block(size_t block_capacity) {
+        size_t bytes = Layout::block_bytes(block_capacity);
+        void* mem = ::operator new[](bytes, std::align_val_t(Layout::block_alignment));
+#ifdef __linux__
+        if constexpr (Layout::huge_pages) madvise(mem, bytes, MADV_HUGEPAGE);
+#endif
+        POOL_POISON_MEMORY(mem, bytes);
+        return mem;
+    }
+    // Poisoned slots are unpoisoned first, ASan expects freed memory to be clean
+    static void free_block(void* mem, size_t bytes) {
+        if (mem) POOL_UNPOISON_MEMORY(mem, bytes);
+        ::operator delete[](mem, std::align_val_t(Layout::block_alignment));
+    }
+    // Under ASan free slots are poisoned: a new block as a whole, a slot again when its
+    // object is erased. Whatever hands a slot out (take_slot, claim, leases, compact and
+    // reorder targets) unpoisons it first.
+    static void poison_slot(Element* place) { POOL_POISON_MEMORY(place, sizeof(Element)); }
+    static void unpoison_slot(Element* place) { POOL_UNPOISON_MEMORY(place, sizeof(Element)); }
+    // Rounds the capacity up to the layout (whole runs), returns the capacity added
+    size_t add_block(size_t block_capacity) {
+        block_capacity = Layout::round_capacity(block_capacity);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        void* mem = allocate_block(block_capacity);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        blocks.push_back({mem, block_capacity, 0, {}});
+        lock_block(blocks.back());
+        auto ms = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+        std::cout << "[pool] Allocated block for " << block_capacity << " objects (" << sizeof(Element) << " bytes each, aligned to " << Layout::block_alignment << (Layout::colored ? ", colored" : "") << ") in " << ms << " microseconds\n";
+        return block_capacity;
+    }
+    void release_block(size_t block_idx) {
+        // Удалить все object_ptrs и free_list, относящиеся к этому блоку
+        size_t base = 0;
+        for (size_t i = 0; i < block_idx; ++i) base += blocks[i].capacity;
+        for (size_t j = 0; j < blocks[block_idx].capacity; ++j) {
+            size_t abs_idx = base + j;
+            if (abs_idx < object_ptrs.size()) {
+                object_ptrs[abs_idx] = nullptr;
+                clear_alive_bit(abs_idx);
+            }
+        }
+        free_list.erase(std::remove_if(free_list.begin(), free_list.end(), [&](size_t i) {
+            return (i >= base && i < base + blocks[block_idx].capacity);
+        }), free_list.end());
+        unlock_block(blocks[block_idx]);
+        free_block(blocks[block_idx].ptr, Layout::block_bytes(blocks[block_idx].capacity));
+        blocks[block_idx].ptr = nullptr;
+        ++released_blocks;
+        first_released = std::min(first_released, block_idx);
+        ++window.releases;
+    }
+    static constexpr size_t batch_prefetch = 16; // objects ahead in scatter/gather
+    // Calls apply(object at indices[i], payload(i)) for every batch position, in batch
+    // order, after checking all of them against the occupancy bitmap. Objects are
+    // addressed from their block, not through object_ptrs, so each access is one cache
+    // miss, not two dependent ones: the block is found by counting block starts <= idx,
+    // a short loop without branches, run once per index when it is prefetched
+    // batch_prefetch positions ahead. Sorting the batch into address order first
+    // (counting and radix sorts carrying the payload) was measured too and cost more
+    // than it saved, even with one index per slot, so it is not done.
+    template<typename Payload, typename Apply>
+    void for_each_in_batch(const std::vector<size_t>& indices, Payload&& payload, Apply&& apply) const {
+        for (size_t idx : indices) {
+            if (idx >= count || !(occupancy[idx >> 6] >> (idx & 63) & 1)) throw std::out_of_range("Index out of range or deleted");
+        }
+        std::vector<size_t> block_begin(blocks.size());
+        std::vector<char*> block_base(blocks.size());
+        for (size_t b = 0, begin = 0; b < blocks.size(); begin += blocks[b++].capacity) {
+            block_begin[b] = begin;
+            block_base[b] = static_cast<char*>(blocks[b].ptr);
+        }
+        auto locate = [&](size_t idx) {
+            size_t b = 0;
+            for (size_t k = 1; k < block_begin.size(); ++k) b += idx >= block_begin[k];
+            return reinterpret_cast<T*>(block_base[b] + Layout::offset_of(idx - block_begin[b]));
+        };
+        const size_t n = indices.size();
+        T* ahead[batch_prefetch]; // located and prefetched, used batch_prefetch positions later
+        for (size_t i = 0; i < n && i < batch_prefetch; ++i) {
+            ahead[i] = locate(indices[i]);
+            __builtin_prefetch(ahead[i]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            T*& slot = ahead[i % batch_prefetch];
+            T* obj = slot;
+            if (i + batch_prefetch < n) {
+                slot = locate(indices[i + batch_prefetch]);
+                __builtin_prefetch(slot);
+            }
+            apply(obj, payload(i));
+        }
+    }
+    void set_alive_bit(size_t idx) { occupancy[idx >> 6] |= uint64_t(1) << (idx & 63); }
+    void clear_alive_bit(size_t idx) { occupancy[idx >> 6] &= ~(uint64_t(1) << (idx & 63)); }
+    // First index >= from whose alive bit differs from invert's, below count
+    size_t find_bit(size_t from, uint64_t invert) const {
+        if (from >= count) return npos;
+        size_t w = from >> 6;
+        uint64_t first = (occupancy[w] ^ invert) & (~uint64_t(0) << (from & 63));
+        size_t idx = first ? w * 64 + __builtin_ctzll(first) : npos;
+        if (idx == npos) {
+            size_t rest = occupancy_kernels().find_first(occupancy.data() + w + 1, occupancy.size() - w - 1, invert);
+            if (rest != npos) idx = (w + 1) * 64 + rest;
+        }
+        return idx < count ? idx : npos;
+    }
+    void reallocate_block(BlockInfo& block) {
+        block.ptr = allocate_block(block.capacity);
+        lock_block(block);
+        --released_blocks;
+    }
+    // The append path only moves forward, so a block released below count is reused
+    // from here once count reaches the capacity: the lowest one (found from
+    // first_released) is allocated again and its slots go on the free list, lowest
+    // index on top
+    void revive_released_block() {
+        size_t base = 0;
+        for (size_t b = 0; b < first_released && b < blocks.size(); ++b) base += blocks[b].capacity;
+        for (size_t b = first_released; b < blocks.size(); base += blocks[b++].capacity) {
+            if (blocks[b].ptr) continue;
+            reallocate_block(blocks[b]);
+            for (size_t i = std::min(base + blocks[b].capacity, count); i-- > base;) free_list.push_back(i);
+            first_released = b + 1;
+            return;
+        }
+        first_released = npos;
+    }
+    bool slot_allocated(size_t global_idx) const {
+        size_t block_idx, offset;
+        get_block_and_offset(global_idx, block_idx, offset);
+        return blocks[block_idx].ptr != nullptr;
+    }
+    // Writes each page's first byte back to itself: the page is faulted in now and
+    // live objects are left unchanged
+    POOL_NO_SANITIZE_ADDRESS static void pretouch(void* mem, size_t bytes) {
+        volatile char* p = static_cast<char*>(mem);
+        for (size_t off = 0; off < bytes; off += 4096) p[off] = p[off];
+    }
+    void lock_block(BlockInfo& block) {
+        if (!lock_memory || block.locked) return;
+        size_t bytes = Layout::block_bytes(block.capacity);
+        pretouch(block.ptr, bytes);
+#if defined(__linux__) || defined(__APPLE__)
+        if (mlock(block.ptr, bytes) == 0) {
+            block.locked = true;
+            locked_bytes += bytes;
+            return;
+        }
+        if (lock_failures == 0) {
+            std::cout << "[pool] mlock of " << bytes << " bytes failed (RLIMIT_MEMLOCK?), continuing unlocked\n";
+        }
+#endif
+        ++lock_failures;
+    }
+    void unlock_block(BlockInfo& block) {
+        if (!block.locked) return;
+        size_t bytes = Layout::block_bytes(block.capacity);
+#if defined(__linux__) || defined(__APPLE__)
+        munlock(block.ptr, bytes);
+#endif
+        block.locked = false;
+        locked_bytes -= bytes;
+    }
+    template<typename V>
+    static void prefault_vector(V& v, size_t capacity) {
+        size_t old_size = v.size();
+        v.resize(std::max(capacity, old_size));
+        v.resize(old_size);
+    }
+    void report_violation(const char* what) {
+        ++realtime_violations;
+        if (violation_handler) violation_handler(what);
+    }
+    // min_capacity: the new block must hold at least that many slots (a claim() run)
+    void grow(size_t min_capacity = 0) {
+        if (realtime) report_violation("grow");
+        growth_decision decision = planned_growth.block_capacity && planned_growth.block_capacity >= min_capacity
+            ? planned_growth : plan_growth(min_capacity);
+        planned_growth = {};
+        size_t new_block_size = decision.block_capacity;
+        if (prealloc) {
+            void* mem = take_prealloc(new_block_size);
+            if (mem) {
+                POOL_POISON_MEMORY(mem, Layout::block_bytes(new_block_size));
+                blocks.push_back({mem, new_block_size, 0, {}});
+                lock_block(blocks.back());
+                std::cout << "[pool] Published pre-allocated block for " << new_block_size << " objects\n";
+            } else {
+                add_block(new_block_size);
+            }
+        } else {
+            add_block(new_block_size);
+        }
+        total_capacity += new_block_size;
+        block_size = new_block_size;
+        occupancy.resize((total_capacity + 63) / 64);
+        last_decision = decision;
+        ++grows;
+        if (prealloc) prealloc_trigger = std::max(count + 1, static_cast<size_t>(total_capacity * prealloc->threshold));
+    }
+    // Decides the next block from the activity since the previous decision; with
+    // background growth that is made when the next block is requested, not in grow()
+    growth_decision plan_growth(size_t min_capacity = 0) {
+        growth_decision d;
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - window.since).count();
+        if (elapsed > 0) {
+            d.insert_rate = window.inserts / elapsed;
+            d.erase_rate = window.erases / elapsed;
+        }
+        d.releases = window.releases;
+        window = {};
+        if (growth_mode == growth_policy::doubling) {
+            d.block_capacity = block_size * 2;
+            d.limited_by = "doubling";
+        } else if (growth_mode == growth_policy::fixed) {
+            d.block_capacity = block_size;
+            d.limited_by = "fixed";
+        } else {
+            // Вставки за target_interval при текущем темпе, но не больше max_waste от живых
+            double by_rate = std::max(0.0, d.insert_rate - d.erase_rate) * std::chrono::duration<double>(growth_interval).count();
+            double by_waste = growth_max_waste * live;
+            double capacity = std::min(by_rate, by_waste);
+            d.limited_by = by_rate <= by_waste ? "rate" : "waste";
+            if (d.releases && capacity < block_size) {
+                capacity = static_cast<double>(block_size);
+                d.limited_by = "churn";
+            }
+            if (capacity < min_block) {
+                capacity = static_cast<double>(min_block);
+                d.limited_by = "minimum";
+            }
+            d.block_capacity = static_cast<size_t>(capacity);
+        }
+        if (d.block_capacity < min_capacity) {
+            d.block_capacity = min_capacity;
+            d.limited_by = "claim";
+        }
+        d.block_capacity = Layout::round_capacity(d.block_capacity);
+        return d;
+    }
+    static void run_prealloc(prealloc_state& state) {
+        std::unique_lock<std::mutex> lock(state.m);
+        while (true) {
+            state.cv.wait(lock, [&] { return state.stopping || state.requested != 0; });
+            if (state.stopping) return;
+            size_t capacity = state.requested;
+            state.requested = 0;
+            lock.unlock();
+            void* mem = ::operator new[](Layout::block_bytes(capacity), std::align_val_t(Layout::block_alignment));
+#ifdef __linux__
+            if constexpr (Layout::huge_pages) madvise(mem, Layout::block_bytes(capacity), MADV_HUGEPAGE);
+#endif
+            if (state.prefault) {
+                volatile char* bytes = static_cast<char*>(mem);
+                for (size_t off = 0; off < Layout::block_bytes(capacity); off += 4096) bytes[off] = 0;
+            }
+            lock.lock();
+            // A block grow() passed over (too late, or planned for another size) is
+            // replaced and freed here, not on the foreground thread
+            void* stale = state.ready;
+            size_t stale_capacity = state.ready_capacity;
+            state.ready = mem;
+            state.ready_capacity = capacity;
+            if (stale) {
+                lock.unlock();
+                free_block(stale, Layout::block_bytes(stale_capacity));
+                lock.lock();
+            }
+        }
+    }
+    // Plans the next block; the helper allocates it unless the ready block already fits
+    void request_prealloc() {
+        {
+            std::lock_guard<std::mutex> lock(prealloc->m);
+            planned_growth = plan_growth();
+            if (prealloc->ready && prealloc->ready_capacity == planned_growth.block_capacity) return;
+            prealloc->requested = planned_growth.block_capacity;
+        }
+        prealloc->cv.notify_all();
+    }
+    // Never waits: returns nullptr while the block is still being allocated or when the
+    // ready one has another size, and grow() allocates synchronously instead
+    void* take_prealloc(size_t capacity) {
+        std::lock_guard<std::mutex> lock(prealloc->m);
+        void* mem = prealloc->ready;
+        if (!mem || prealloc->ready_capacity != capacity) return nullptr;
+        prealloc->ready = nullptr;
+        return mem;
+    }
+    void get_block_and_offset(size_t global_idx, size_t& block_idx, size_t& offset) const {
+        size_t idx = global_idx;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (idx < blocks[i].capacity) {
+                block_idx = i;
+                offset = idx;
+                return;
+            }
+            idx -= blocks[i].capacity;
+        }
+        throw std::out_of_range("Internal pool index error");
+    }
+
+};
+
+// fixed_pool: pool with compile-time block geometry
+// Every block holds 2^BlockShift objects, so operator[] is a shift, a mask and one load:
+// directory[i >> BlockShift] + (i & block_mask) * sizeof(Element), with no loop or division.
+// The block directory is sized once from max_capacity and never reallocates,
+// so block pointers and object addresses stay stable for the pool's lifetime.
+
+template<typename T, size_t BlockShift = 12, typename Layout = pool_layout<T>>
+class fixed_pool final : public any_pool {
+    struct alignas(64) Element {
+        T obj;
+        char padding[Layout::padding];
+    };
+    static_assert(sizeof(Element) == Layout::stride, "Element must match the layout stride");
+    static_assert(Layout::contiguous, "fixed_pool addresses slots as an Element array");
+
+public:
+    static constexpr size_t block_capacity = size_t(1) << BlockShift;
+    static constexpr size_t block_mask = block_capacity - 1;
+    static_assert(block_capacity % 64 == 0, "BlockShift must be at least 6 (one occupancy word per 64 slots)");
+
+    explicit fixed_pool(size_t max_capacity)
+        : directory_size((max_capacity + block_mask) >> BlockShift),
+          directory(new Element*[directory_size]()),
+          alive(new uint64_t[directory_size * (block_capacity / 64)]()),
+          idle(new idle_tracker[directory_size]),
+          count(0), live(0), allocated_blocks(0) {}
+    fixed_pool(const fixed_pool&) = delete;
+    fixed_pool& operator=(const fixed_pool&) = delete;
+    ~fixed_pool() {
+        for (size_t i = 0; i < count; ++i) {
+            if (is_alive(i)) element(i).obj.~T();
+        }
+        for (size_t b = 0; b < directory_size; ++b) {
+            if (directory[b]) ::operator delete[](directory[b], std::align_val_t(64));
+        }
+    }
+    template<typename... Args>
+    void push_back(Args&&... args) {
+        emplace(std::forward<Args>(args)...);
+    }
+    // Same as push_back, returns the slot index
+    template<typename... Args>
+    size_t emplace(Args&&... args) {
+        return construct_slot([&](void* place) { new (place) T(std::forward<Args>(args)...); });
+    }
+    size_t emplace_default_init() {
+        return construct_slot([](void* place) { new (place) T; });
+    }
+    size_t emplace_uninit() {
+        static_assert(std::is_trivially_default_constructible_v<T>, "emplace_uninit requires a trivially default constructible T");
+        return emplace_default_init();
+    }
+    // Unchecked: idx must be alive
+    T& operator[](size_t idx) { return element(idx).obj; }
+    const T& operator[](size_t idx) const { return element(idx).obj; }
+    T& at(size_t idx) {
+        if (!is_alive(idx)) throw std::out_of_range("Index out of range or deleted");
+        return element(idx).obj;
+    }
+    const T& at(size_t idx) const {
+        if (!is_alive(idx)) throw std::out_of_range("Index out of range or deleted");
+        return element(idx).obj;
+    }
+    void erase(size_t idx) override {
+        if (!is_alive(idx)) throw std::out_of_range("Index out of range or already deleted");
+        element(idx).obj.~T();
+        alive[idx >> 6] &= ~(uint64_t(1) << (idx & 63));
+        free_list.push_back(idx);
+        ++idle[idx >> BlockShift].erases;
+        --live;
+    }
+    bool is_alive(size_t idx) const override {
+        return idx < count && (alive[idx >> 6] >> (idx & 63)) & 1;
+    }
+    template<typename F>
+    void for_each_alive(F&& f) {
+        for (size_t i = 0; i < count; ++i) {
+            if (is_alive(i)) f(element(i).obj, i);
+        }
+    }
+    // As in pool: the slot high-water mark, live_count() counts the objects
+    size_t size() const { return count; }
+    size_t live_count() const { return live; }
+    size_t capacity() const { return allocated_blocks * block_capacity; }
+    size_t max_size() const { return directory_size * block_capacity; }
+
+    // any_pool
+    pool_stats stats() const override {
+        pool_stats s;
+        s.live = live;
+        s.slots = count;
+        s.capacity = capacity();
+        s.free_slots = free_list.size();
+        s.blocks = allocated_blocks;
+        s.element_size = sizeof(Element);
+        s.committed_bytes = allocated_blocks * block_capacity * sizeof(Element);
+        s.decommitted_bytes = decommitted;
+        return s;
+    }
+    size_t trim() override {
+        // Free-list entries may point into released blocks; push_back re-allocates them
+        size_t released = 0;
+        for (size_t b = 0; b < directory_size; ++b) {
+            if (directory[b] && block_live(b) == 0) {
+                ::operator delete[](directory[b], std::align_val_t(64));
+                directory[b] = nullptr;
+                --allocated_blocks;
+                released += block_capacity * sizeof(Element);
+            }
+        }
+        return released;
+    }
+    size_t compact(std::vector<size_t>* remap) override {
+        if (remap) {
+            remap->assign(count, npos);
+            for (size_t i = 0; i < count; ++i) {
+                if (is_alive(i)) (*remap)[i] = i;
+            }
+        }
+        if constexpr (!std::is_move_constructible_v<T>) {
+            return 0;
+        } else {
+            size_t moved = 0;
+            size_t lo = 0, hi = count;
+            while (true) {
+                while (lo < hi && is_alive(lo)) ++lo;
+                while (hi > lo && !is_alive(hi - 1)) --hi;
+                if (lo + 1 >= hi) break;
+                size_t src = hi - 1;
+                if (!directory[lo >> BlockShift]) add_block(lo >> BlockShift);
+                new (&element(lo).obj) T(std::move(element(src).obj));
+                element(src).obj.~T();
+                alive[lo >> 6] |= uint64_t(1) << (lo & 63);
+                alive[src >> 6] &= ~(uint64_t(1) << (src & 63));
+                if (remap) (*remap)[src] = lo;
+                ++moved;
+                --hi;
+            }
+            while (hi > 0 && !is_alive(hi - 1)) --hi;
+            count = hi;
+            free_list.clear();
+            return moved;
+        }
+    }
+    pool_snapshot snapshot() const override {
+        pool_snapshot snap;
+        snap.element_size = sizeof(T);
+        snap.has_bytes = std::is_trivially_copyable_v<T>;
+        for (size_t i = 0; i < count; ++i) {
+            if (!is_alive(i)) continue;
+            snap.indices.push_back(i);
+            if (snap.has_bytes) {
+                const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&element(i).obj);
+                snap.bytes.insert(snap.bytes.end(), bytes, bytes + sizeof(T));
+            }
+        }
+        return snap;
+    }
+    void visit_slots(const std::function<void(const raw_slot&)>& f) override {
+        for (size_t i = 0; i < count; ++i) {
+            if (is_alive(i)) f(raw_slot{&element(i).obj, i, sizeof(T), &destroy_object});
+        }
+    }
+    // Fully empty blocks are decommitted as a whole, trim() releases them
+    size_t decommit_idle(std::chrono::steady_clock::duration min_idle, size_t max_bytes) override {
+        auto now = std::chrono::steady_clock::now();
+        size_t released = 0;
+        for (size_t b = 0; b < directory_size && released < max_bytes; ++b) {
+            if (!directory[b] || !idle[b].ready(now, min_idle)) continue;
+            size_t base = b << BlockShift;
+            size_t used = count > base ? std::min(block_capacity, count - base) : 0;
+            released += decommit_free_slots<Layout>(reinterpret_cast<char*>(directory[b]), used,
+                [&](size_t j) { return !is_alive(base + j); }, max_bytes - released, idle[b].resume);
+            idle[b].scavenged = idle[b].resume == 0;
+        }
+        decommitted += released;
+        return released;
+    }
+private:
+    size_t directory_size;
+    std::unique_ptr<Element*[]> directory; // fixed size, never reallocated
+    std::unique_ptr<uint64_t[]> alive;     // one bit per slot
+    std::unique_ptr<idle_tracker[]> idle;  // per block
+    std::vector<size_t> free_list;
+    size_t count;
+    size_t live;
+    size_t allocated_blocks;
+    size_t decommitted = 0;
+
+    static void destroy_object(void* obj) { static_cast<T*>(obj)->~T(); }
+    template<typename Construct>
+    size_t construct_slot(Construct&& construct) {
+        size_t insert_idx;
+        if (!free_list.empty()) {
+            insert_idx = free_list.back();
+            free_list.pop_back();
+            if (!directory[insert_idx >> BlockShift]) add_block(insert_idx >> BlockShift);
+        } else {
+            if (count == max_size()) throw std::length_error("fixed_pool is full");
+            insert_idx = count;
+            if (!directory[insert_idx >> BlockShift]) add_block(insert_idx >> BlockShift);
+            ++count;
+        }
+        try {
+            construct(&element(insert_idx).obj);
+        } catch (...) {
+            free_list.push_back(insert_idx);
+            throw;
+        }
+        alive[insert_idx >> 6] |= uint64_t(1) << (insert_idx & 63);
+        ++live;
+        return insert_idx;
+    }
+    Element& element(size_t idx) const { return directory[idx >> BlockShift][idx & block_mask]; }
+    size_t block_live(size_t block_idx) const {
+        return occupancy_kernels().popcount(&alive[block_idx * (block_capacity / 64)], block_capacity / 64);
+    }
+    void add_block(size_t block_idx) {
+        directory[block_idx] = static_cast<Element*>(::operator new[](block_capacity * sizeof(Element), std::align_val_t(64)));
+        ++allocated_blocks;
+    }
+};
+
+// reserved_pool: one contiguous virtual range reserved up front
+// The range for max_capacity objects is mapped PROT_NONE with MAP_NORESERVE, so it costs
+// address space but no memory, and is committed (made read/write) in commit_chunk steps
+// as the pool grows. Slot i is at base + i * stride: no block lookup, growth never
+// copies or remaps, and object addresses are stable for the pool's lifetime.
+
+template<typename T, typename Layout = pool_layout<T>>
+class reserved_pool final : public any_pool {
+    struct alignas(64) Element {
+        T obj;
+        char padding[Layout::padding];
+    };
+    static_assert(sizeof(Element) == Layout::stride, "Element must match the layout stride");
+    static_assert(Layout::contiguous, "reserved_pool addresses slots as base + i * stride");
+
+public:
+    static constexpr size_t commit_chunk = size_t(2) << 20;
+
+    explicit reserved_pool(size_t max_capacity)
+        : max_capacity(max_capacity),
+          reserved_bytes((max_capacity * sizeof(Element) + commit_chunk - 1) / commit_chunk * commit_chunk),
+          committed_bytes(0), count(0), live(0) {
+#if defined(__linux__) || defined(__APPLE__)
+        void* mem = mmap(nullptr, reserved_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mem == MAP_FAILED) throw std::bad_alloc();
+        base = static_cast<char*>(mem);
+#else
+        // Без mmap: весь диапазон выделяется сразу
+        base = static_cast<char*>(::operator new[](reserved_bytes, std::align_val_t(64)));
+        committed_bytes = reserved_bytes;
+#endif
+    }
+    reserved_pool(const reserved_pool&) = delete;
+    reserved_pool& operator=(const reserved_pool&) = delete;
+    ~reserved_pool() {
+        for (size_t i = 0; i < count; ++i) {
+            if (is_alive(i)) element(i).obj.~T();
+        }
+#if defined(__linux__) || defined(__APPLE__)
+        munmap(base, reserved_bytes);
+#else
+        ::operator delete[](base, std::align_val_t(64));
+#endif
+    }
+    template<typename... Args>
+    void push_back(Args&&... args) {
+        emplace(std::forward<Args>(args)...);
+    }
+    // Same as push_back, returns the slot index
+    template<typename... Args>
+    size_t emplace(Args&&... args) {
+        size_t insert_idx;
+        if (!free_list.empty()) {
+            insert_idx = free_list.back();
+            free_list.pop_back();
+        } else {
+            if (count == max_capacity) throw std::length_error("reserved_pool is full");
+            commit((count + 1) * sizeof(Element));
+            insert_idx = count;
+            if (insert_idx % 64 == 0) alive.push_back(0);
+            ++count;
+        }
+        try {
+            new (&element(insert_idx).obj) T(std::forward<Args>(args)...);
+        } catch (...) {
+            free_list.push_back(insert_idx);
+            throw;
+        }
+        alive[insert_idx >> 6] |= uint64_t(1) << (insert_idx & 63);
+        ++live;
+        return insert_idx;
+    }
+    // Unchecked: idx must be alive
+    T& operator[](size_t idx) { return element(idx).obj; }
+    const T& operator[](size_t idx) const { return element(idx).obj; }
+    T& at(size_t idx) {
+        if (!is_alive(idx)) throw std::out_of_range("Index out of range or deleted");
+        return element(idx).obj;
+    }
+    void erase(size_t idx) override {
+        if (!is_alive(idx)) throw std::out_of_range("Index out of range or already deleted");
+        element(idx).obj.~T();
+        alive[idx >> 6] &= ~(uint64_t(1) << (idx & 63));
+        free_list.push_back(idx);
+        ++idle.erases;
+        --live;
+    }
+    bool is_alive(size_t idx) const override {
+        return idx < count && (alive[idx >> 6] >> (idx & 63)) & 1;
+    }
+    template<typename F>
+    void for_each_alive(F&& f) {
+        for (size_t i = 0; i < count; ++i) {
+            if (is_alive(i)) f(element(i).obj, i);
+        }
+    }
+    size_t size() const { return count; }
+    size_t live_count() const { return live; }
+    size_t capacity() const { return committed_bytes / sizeof(Element); }
+    size_t max_size() const { return max_capacity; }
+
+    // any_pool
+    pool_stats stats() const override {
+        pool_stats s;
+        s.live = live;
+        s.slots = count;
+        s.capacity = capacity();
+        s.free_slots = free_list.size();
+        s.blocks = 1;
+        s.element_size = sizeof(Element);
+        s.committed_bytes = committed_bytes;
+        s.decommitted_bytes = decommitted;
+        return s;
+    }
+    // Decommits whole chunks past the last slot in use
+    size_t trim() override {
+        size_t keep = (count * sizeof(Element) + commit_chunk - 1) / commit_chunk * commit_chunk;
+        if (keep >= committed_bytes) return 0;
+        size_t released = committed_bytes - keep;
+#if defined(__linux__) || defined(__APPLE__)
+        if (mmap(base + keep, released, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED) return 0;
+        committed_bytes = keep;
+        return released;
+#else
+        return 0;
+#endif
+    }
+    size_t compact(std::vector<size_t>* remap) override {
+        if (remap) {
+            remap->assign(count, npos);
+            for (size_t i = 0; i < count; ++i) {
+                if (is_alive(i)) (*remap)[i] = i;
+            }
+        }
+        if constexpr (!std::is_move_constructible_v<T>) {
+            return 0;
+        } else {
+            size_t moved = 0;
+            size_t lo = 0, hi = count;
+            while (true) {
+                while (lo < hi && is_alive(lo)) ++lo;
+                while (hi > lo && !is_alive(hi - 1)) --hi;
+                if (lo + 1 >= hi) break;
+                size_t src = hi - 1;
+                new (&element(lo).obj) T(std::move(element(src).obj));
+                element(src).obj.~T();
+                alive[lo >> 6] |= uint64_t(1) << (lo & 63);
+                alive[src >> 6] &= ~(uint64_t(1) << (src & 63));
+                if (remap) (*remap)[src] = lo;
+                ++moved;
+                --hi;
+            }
+            while (hi > 0 && !is_alive(hi - 1)) --hi;
+            count = hi;
+            alive.resize((count + 63) / 64);
+            free_list.clear();
+            return moved;
+        }
+    }
+    pool_snapshot snapshot() const override {
+        pool_snapshot snap;
+        snap.element_size = sizeof(T);
+        snap.has_bytes = std::is_trivially_copyable_v<T>;
+        for (size_t i = 0; i < count; ++i) {
+            if (!is_alive(i)) continue;
+            snap.indices.push_back(i);
+            if (snap.has_bytes) {
+                const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&element(i).obj);
+                snap.bytes.insert(snap.bytes.end(), bytes, bytes + sizeof(T));
+            }
+        }
+        return snap;
+    }
+    void visit_slots(const std::function<void(const raw_slot&)>& f) override {
+        for (size_t i = 0; i < count; ++i) {
+            if (is_alive(i)) f(raw_slot{&element(i).obj, i, sizeof(T), &destroy_object});
+        }
+    }
+    size_t decommit_idle(std::chrono::steady_clock::duration min_idle, size_t max_bytes) override {
+        if (!idle.ready(std::chrono::steady_clock::now(), min_idle)) return 0;
+        size_t released = decommit_free_slots<Layout>(base, count, [&](size_t j) { return !is_alive(j); }, max_bytes, idle.resume);
+        idle.scavenged = idle.resume == 0;
+        decommitted += released;
+        return released;
+    }
+private:
+    char* base;
+    size_t max_capacity;
+    size_t reserved_bytes;
+    size_t committed_bytes;
+    std::vector<uint64_t> alive; // one bit per slot below count
+    std::vector<size_t> free_list;
+    size_t count;
+    size_t live;
+    idle_tracker idle;
+    size_t decommitted = 0;
+
+    static void destroy_object(void* obj) { static_cast<T*>(obj)->~T(); }
+    Element& element(size_t idx) const { return reinterpret_cast<Element*>(base)[idx]; }
+    void commit(size_t end_bytes) {
+        if (end_bytes <= committed_bytes) return;
+#if defined(__linux__) || defined(__APPLE__)
+        size_t new_committed = std::min((end_bytes + commit_chunk - 1) / commit_chunk * commit_chunk, reserved_bytes);
+        if (mprotect(base + committed_bytes, new_committed - committed_bytes, PROT_READ | PROT_WRITE) != 0) throw std::bad_alloc();
+        committed_bytes = new_committed;
+#endif
+    }
+};
+
+// packed_pool: dense storage for small trivially copyable T (ids, flags, counters)
+// Objects are stored back to back with no per-element padding and no object_ptrs;
+// occupancy is one bit per slot, so a 4-byte T costs 4 bytes + 1 bit
+// and a cache line holds 64 / sizeof(T) objects.
+
+template<typename T, size_t BlockShift = 12>
+class packed_pool final : public any_pool {
+    static_assert(std::is_trivially_copyable_v<T>, "packed_pool requires a trivially copyable T");
+    static_assert(sizeof(T) <= 16, "packed_pool is meant for objects of at most 16 bytes, use pool for larger T");
+
+public:
+    static constexpr size_t block_capacity = size_t(1) << BlockShift;
+    static constexpr size_t block_mask = block_capacity - 1;
+    static constexpr size_t words_per_block = block_capacity / 64;
+    static_assert(block_capacity % 64 == 0, "BlockShift must be at least 6 (one occupancy word per 64 slots)");
+
+    packed_pool() : live(0), first_free_block(0), allocated_blocks(0) {}
+    packed_pool(const packed_pool&) = delete;
+    packed_pool& operator=(const packed_pool&) = delete;
+    ~packed_pool() {
+        for (Block* block : blocks) delete block;
+    }
+    void push_back(const T& value) {
+        emplace(value);
+    }
+    // Takes the lowest free slot, so the pool stays dense under churn; returns its index
+    size_t emplace(const T& value) {
+        size_t block_idx = first_free_block;
+        while (block_idx < blocks.size() && blocks[block_idx] && blocks[block_idx]->live == block_capacity) ++block_idx;
+        if (block_idx == blocks.size()) blocks.push_back(nullptr);
+        if (!blocks[block_idx]) add_block(block_idx);
+        Block& block = *blocks[block_idx];
+        size_t w = 0;
+        while (~block.bits[w] == 0) ++w;
+        size_t bit = __builtin_ctzll(~block.bits[w]);
+        block.bits[w] |= uint64_t(1) << bit;
+        size_t offset = w * 64 + bit;
+        std::memcpy(&block.slots()[offset], &value, sizeof(T));
+        ++block.live;
+        ++live;
+        first_free_block = block_idx;
+        return (block_idx << BlockShift) + offset;
+    }
+    // Unchecked: idx must be alive
+    T& operator[](size_t idx) { return blocks[idx >> BlockShift]->slots()[idx & block_mask]; }
+    const T& operator[](size_t idx) const { return blocks[idx >> BlockShift]->slots()[idx & block_mask]; }
+    T& at(size_t idx) {
+        if (!is_alive(idx)) throw std::out_of_range("Index out of range or deleted");
+        return (*this)[idx];
+    }
+    void erase(size_t idx) override {
+        if (!is_alive(idx)) throw std::out_of_range("Index out of range or already deleted");
+        Block& block = *blocks[idx >> BlockShift];
+        size_t offset = idx & block_mask;
+        block.bits[offset >> 6] &= ~(uint64_t(1) << (offset & 63));
+        --block.live;
+        --live;
+        first_free_block = std::min(first_free_block, idx >> BlockShift);
+    }
+    bool is_alive(size_t idx) const override {
+        size_t block_idx = idx >> BlockShift;
+        if (block_idx >= blocks.size() || !blocks[block_idx]) return false;
+        size_t offset = idx & block_mask;
+        return (blocks[block_idx]->bits[offset >> 6] >> (offset & 63)) & 1;
+    }
+    // Walks the occupancy words, skipping 64 free slots at a time
+    template<typename F>
+    void for_each_alive(F&& f) {
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (!blocks[b] || blocks[b]->live == 0) continue;
+            Block& block = *blocks[b];
+            for (size_t w = 0; w < words_per_block; ++w) {
+                for (uint64_t bits = block.bits[w]; bits; bits &= bits - 1) {
+                    size_t offset = w * 64 + __builtin_ctzll(bits);
+                    f(block.slots()[offset], (b << BlockShift) + offset);
+                }
+            }
+        }
+    }
+    size_t size() const { return blocks.size() * block_capacity; }
+    size_t live_count() const { return live; }
+    size_t capacity() const { return allocated_blocks * block_capacity; }
+
+    // any_pool
+    pool_stats stats() const override {
+        pool_stats s;
+        s.live = live;
+        s.slots = blocks.size() * block_capacity;
+        s.capacity = capacity();
+        s.free_slots = capacity() - live;
+        s.blocks = allocated_blocks;
+        s.element_size = sizeof(T);
+        s.committed_bytes = allocated_blocks * sizeof(Block);
+        return s;
+    }
+    size_t trim() override {
+        size_t released = 0;
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (blocks[b] && blocks[b]->live == 0) {
+                delete blocks[b];
+                blocks[b] = nullptr;
+                --allocated_blocks;
+                released += sizeof(Block);
+            }
+        }
+        while (!blocks.empty() && !blocks.back()) blocks.pop_back();
+        first_free_block = std::min(first_free_block, blocks.size());
+        return released;
+    }
+    size_t compact(std::vector<size_t>* remap) override {
+        size_t end = blocks.size() * block_capacity;
+        if (remap) {
+            remap->assign(end, npos);
+            for_each_alive([&](T&, size_t i) { (*remap)[i] = i; });
+        }
+        size_t moved = 0;
+        size_t lo = 0, hi = end;
+        while (true) {
+            while (lo < hi && is_alive(lo)) ++lo;
+            while (hi > lo && !is_alive(hi - 1)) --hi;
+            if (lo + 1 >= hi) break;
+            size_t src = hi - 1;
+            if (!blocks[lo >> BlockShift]) add_block(lo >> BlockShift);
+            Block& to = *blocks[lo >> BlockShift];
+            Block& from = *blocks[src >> BlockShift];
+            size_t to_offset = lo & block_mask, from_offset = src & block_mask;
+            std::memcpy(&to.slots()[to_offset], &from.slots()[from_offset], sizeof(T));
+            to.bits[to_offset >> 6] |= uint64_t(1) << (to_offset & 63);
+            from.bits[from_offset >> 6] &= ~(uint64_t(1) << (from_offset & 63));
+            ++to.live;
+            --from.live;
+            if (remap) (*remap)[src] = lo;
+            ++moved;
+            --hi;
+        }
+        first_free_block = lo >> BlockShift;
+        return moved;
+    }
+    pool_snapshot snapshot() const override {
+        pool_snapshot snap;
+        snap.element_size = sizeof(T);
+        snap.has_bytes = true;
+        const_cast<packed_pool*>(this)->for_each_alive([&](T& obj, size_t i) {
+            snap.indices.push_back(i);
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&obj);
+            snap.bytes.insert(snap.bytes.end(), bytes, bytes + sizeof(T));
+        });
+        return snap;
+    }
+    void visit_slots(const std::function<void(const raw_slot&)>& f) override {
+        for_each_alive([&](T& obj, size_t i) { f(raw_slot{&obj, i, sizeof(T), &destroy_object}); });
+    }
+private:
+    struct Block {
+        uint64_t bits[words_per_block]; // occupancy, one bit per slot
+        size_t live;
+        alignas(64) unsigned char storage[block_capacity * sizeof(T)];
+        T* slots() { return reinterpret_cast<T*>(storage); }
+        const T* slots() const { return reinterpret_cast<const T*>(storage); }
+    };
+    std::vector<Block*> blocks;  // nullptr for trimmed blocks
+    size_t live;
+    size_t first_free_block;     // no block below this one has a free slot
+    size_t allocated_blocks;
+
+    static void destroy_object(void*) {} // trivially copyable T has nothing to destroy
+    void add_block(size_t block_idx) {
+        Block* block = new Block;
+        std::memset(block->bits, 0, sizeof(block->bits));
+        block->live = 0;
+        blocks[block_idx] = block;
+        ++allocated_blocks;
+    }
+};
+
+// sparse_pool: objects addressed by external ids from a sparse 2^IndexBits range
+// A two-level radix directory maps id -> block: the top level splits the id space
+// into leaves, a leaf holds 4096 block pointers, and only leaves and blocks covering
+// populated id ranges are allocated. The top level comes from calloc, so its pages
+// are only committed once a leaf pointer is stored in them. emplace_at/operator[] are two loads and a bit
+// test; memory is proportional to the populated ranges, not to the largest id.
+// Blocks and leaves are freed as soon as their last object is erased.
+
+template<typename T, size_t BlockShift = 10, size_t IndexBits = 40, typename Layout = pool_layout<T>>
+class sparse_pool final : public any_pool {
+    struct alignas(64) Element {
+        T obj;
+        char padding[Layout::padding];
+    };
+    static_assert(sizeof(Element) == Layout::stride, "Element must match the layout stride");
+    static_assert(Layout::contiguous, "sparse_pool addresses slots as an Element array");
+
+public:
+    static constexpr size_t block_capacity = size_t(1) << BlockShift;
+    static constexpr size_t block_mask = block_capacity - 1;
+    static constexpr size_t leaf_bits = 12;
+    static constexpr size_t top_bits = IndexBits - BlockShift - leaf_bits;
+    static constexpr size_t max_id = (size_t(1) << IndexBits) - 1;
+    static_assert(block_capacity % 64 == 0, "BlockShift must be at least 6 (one occupancy word per 64 slots)");
+    static_assert(IndexBits > BlockShift + leaf_bits, "IndexBits too small for the block and leaf sizes");
+
+    sparse_pool()
+        : top(static_cast<Leaf**>(std::calloc(size_t(1) << top_bits, sizeof(Leaf*)))), live(0), id_end(0), allocated_blocks(0), allocated_leaves(0) {
+        if (!top) throw std::bad_alloc();
+    }
+    sparse_pool(const sparse_pool&) = delete;
+    sparse_pool& operator=(const sparse_pool&) = delete;
+    ~sparse_pool() {
+        for (size_t t = 0; t < (size_t(1) << top_bits); ++t) {
+            Leaf* leaf = top[t];
+            if (!leaf) continue;
+            for (size_t l = 0; l < (size_t(1) << leaf_bits); ++l) {
+                if (leaf->blocks[l]) free_block(leaf->blocks[l]);
+            }
+            delete leaf;
+        }
+        std::free(top);
+    }
+    template<typename... Args>
+    T& emplace_at(size_t id, Args&&... args) {
+        if (id > max_id) throw std::out_of_range("Index out of range");
+        size_t top_idx = id >> (BlockShift + leaf_bits);
+        Leaf*& leaf = top[top_idx];
+        if (!leaf) {
+            leaf = new Leaf();
+            ++allocated_leaves;
+        }
+        Block*& block = leaf->blocks[(id >> BlockShift) & ((size_t(1) << leaf_bits) - 1)];
+        if (!block) {
+            block = new Block();
+            block->slots = static_cast<Element*>(::operator new[](block_capacity * sizeof(Element), std::align_val_t(64)));
+            ++leaf->blocks_used;
+            ++allocated_blocks;
+        }
+        size_t offset = id & block_mask;
+        if ((block->alive[offset >> 6] >> (offset & 63)) & 1) throw std::out_of_range("Index already in use");
+        T* obj;
+        try {
+            obj = new (&block->slots[offset].obj) T(std::forward<Args>(args)...);
+        } catch (...) {
+            // Блок и лист, созданные под этот id, не должны остаться пустыми
+            release_empty_block(top_idx, block);
+            throw;
+        }
+        block->alive[offset >> 6] |= uint64_t(1) << (offset & 63);
+        ++block->live;
+        ++live;
+        id_end = std::max(id_end, id + 1);
+        return *obj;
+    }
+    // nullptr when id is not populated
+    T* find(size_t id) {
+        if (id > max_id) return nullptr;
+        Leaf* leaf = top[id >> (BlockShift + leaf_bits)];
+        if (!leaf) return nullptr;
+        Block* block = leaf->blocks[(id >> BlockShift) & ((size_t(1) << leaf_bits) - 1)];
+        size_t offset = id & block_mask;
+        if (!block || !((block->alive[offset >> 6] >> (offset & 63)) & 1)) return nullptr;
+        return &block->slots[offset].obj;
+    }
+    const T* find(size_t id) const { return const_cast<sparse_pool*>(this)->find(id); }
+    T& operator[](size_t id) {
+        T* obj = find(id);
+        if (!obj) throw std::out_of_range("Index out of range or deleted");
+        return *obj;
+    }
+    const T& operator[](size_t id) const {
+        const T* obj = find(id);
+        if (!obj) throw std::out_of_range("Index out of range or deleted");
+        return *obj;
+    }
+    void erase(size_t id) override {
+        T* obj = find(id);
+        if (!obj) throw std::out_of_range("Index out of range or already deleted");
+        obj->~T();
+        size_t top_idx = id >> (BlockShift + leaf_bits);
+        Leaf* leaf = top[top_idx];
+        Block*& block = leaf->blocks[(id >> BlockShift) & ((size_t(1) << leaf_bits) - 1)];
+        size_t offset = id & block_mask;
+        block->alive[offset >> 6] &= ~(uint64_t(1) << (offset & 63));
+        --live;
+        --block->live;
+        release_empty_block(top_idx, block);
+    }
+    bool is_alive(size_t id) const override { return find(id) != nullptr; }
+    // Ascending id order
+    template<typename F>
+    void for_each_alive(F&& f) {
+        for (size_t t = 0; t < (size_t(1) << top_bits); ++t) {
+            Leaf* leaf = top[t];
+            if (!leaf) continue;
+            for (size_t l = 0; l < (size_t(1) << leaf_bits); ++l) {
+                Block* block = leaf->blocks[l];
+                if (!block) continue;
+                size_t base = ((t << leaf_bits) | l) << BlockShift;
+                for (size_t w = 0; w < block_capacity / 64; ++w) {
+                    for (uint64_t bits = block->alive[w]; bits; bits &= bits - 1) {
+                        size_t offset = w * 64 + __builtin_ctzll(bits);
+                        f(block->slots[offset].obj, base + offset);
+                    }
+                }
+            }
+        }
+    }
+    // One past the highest id emplaced, live_count() counts the objects
+    size_t size() const { return id_end; }
+    size_t live_count() const { return live; }
+
+    // any_pool
+    pool_stats stats() const override {
+        pool_stats s;
+        s.live = live;
+        s.slots = allocated_blocks * block_capacity;
+        s.capacity = s.slots;
+        s.free_slots = s.slots - live;
+        s.blocks = allocated_blocks;
+        s.element_size = sizeof(Element);
+        s.committed_bytes = allocated_blocks * (block_capacity * sizeof(Element) + sizeof(Block))
+                          + allocated_leaves * sizeof(Leaf) + (size_t(1) << top_bits) * sizeof(Leaf*);
+        return s;
+    }
+    // Empty blocks and leaves are already freed by erase
+    size_t trim() override { return 0; }
+    // Ids are chosen by the caller, so objects never move
+    size_t compact(std::vector<size_t>*) override { return 0; }
+    pool_snapshot snapshot() const override {
+        pool_snapshot snap;
+        snap.element_size = sizeof(T);
+        snap.has_bytes = std::is_trivially_copyable_v<T>;
+        const_cast<sparse_pool*>(this)->for_each_alive([&](T& obj, size_t id) {
+            snap.indices.push_back(id);
+            if (snap.has_bytes) {
+                const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&obj);
+                snap.bytes.insert(snap.bytes.end(), bytes, bytes + sizeof(T));
+            }
+        });
+        return snap;
+    }
+    void visit_slots(const std::function<void(const raw_slot&)>& f) override {
+        for_each_alive([&](T& obj, size_t id) { f(raw_slot{&obj, id, sizeof(T), &destroy_object}); });
+    }
+private:
+    struct Block {
+        uint64_t alive[block_capacity / 64] = {};
+        size_t live = 0;
+        Element* slots = nullptr;
+    };
+    struct Leaf {
+        Block* blocks[size_t(1) << leaf_bits] = {};
+        size_t blocks_used = 0;
+    };
+    Leaf** top; // 2^top_bits entries
+    size_t live;
+    size_t id_end; // one past the highest id emplaced
+    size_t allocated_blocks;
+    size_t allocated_leaves;
+
+    static void destroy_object(void* obj) { static_cast<T*>(obj)->~T(); }
+    // Frees block (an entry of top[top_idx]) once it holds no live objects, and the
+    // leaf once it holds no blocks
+    void release_empty_block(size_t top_idx, Block*& block) {
+        if (block->live != 0) return;
+        free_block(block);
+        block = nullptr;
+        --allocated_blocks;
+        Leaf* leaf = top[top_idx];
+        if (--leaf->blocks_used == 0) {
+            delete leaf;
+            top[top_idx] = nullptr;
+            --allocated_leaves;
+        }
+    }
+    static void free_block(Block* block) {
+        for (size_t w = 0; w < block_capacity / 64; ++w) {
+            for (uint64_t bits = block->alive[w]; bits; bits &= bits - 1) {
+                block->slots[w * 64 + __builtin_ctzll(bits)].obj.~T();
+            }
+        }
+        ::operator delete[](block->slots, std::align_val_t(64));
+        delete block;
+    }
+};
+
+// intern_pool: hash-consing over pool<T> for immutable objects
+// intern(args...) builds the would-be object, hashes it and returns the slot index of an
+// equal object if there is one (adding a reference), otherwise it moves the object into
+// the pool. release() drops a reference and erases the object with the last one.
+// Lookup is an open-addressing table (linear probing) over slot indices; the hash of
+// every slot is cached so probing and rehashing never rehash objects.
+
+template<typename T, typename Hash = std::hash<T>, typename Eq = std::equal_to<T>>
+class intern_pool {
+public:
+    explicit intern_pool(size_t initial_capacity) : objects(initial_capacity), table(16, empty_slot), used(0), tombstones(0) {}
+    template<typename... Args>
+    size_t intern(Args&&... args) {
+        T candidate(std::forward<Args>(args)...);
+        size_t h = hasher(candidate);
+        size_t mask = table.size() - 1;
+        size_t insert_at = npos;
+        for (size_t pos = h & mask;; pos = (pos + 1) & mask) {
+            size_t idx = table[pos];
+            if (idx == empty_slot) {
+                if (insert_at == npos) insert_at = pos;
+                break;
+            }
+            if (idx == tombstone) {
+                if (insert_at == npos) insert_at = pos;
+                continue;
+            }
+            if (hashes[idx] == h && equal(objects[idx], candidate)) {
+                ++refs[idx];
+                return idx;
+            }
+        }
+        size_t idx = objects.emplace(std::move(candidate));
+        if (idx >= refs.size()) {
+            refs.resize(idx + 1, 0);
+            hashes.resize(idx + 1, 0);
+        }
+        refs[idx] = 1;
+        hashes[idx] = h;
+        if (table[insert_at] == tombstone) --tombstones;
+        table[insert_at] = idx;
+        ++used;
+        if ((used + tombstones) * 2 > table.size()) rehash(used * 4 > table.size() ? table.size() * 2 : table.size());
+        return idx;
+    }
+    void retain(size_t idx) {
+        if (!objects.is_alive(idx)) throw std::out_of_range("Index out of range or deleted");
+        ++refs[idx];
+    }
+    void release(size_t idx) {
+        if (!objects.is_alive(idx)) throw std::out_of_range("Index out of range or already deleted");
+        if (--refs[idx] != 0) return;
+        size_t mask = table.size() - 1;
+        for (size_t pos = hashes[idx] & mask;; pos = (pos + 1) & mask) {
+            if (table[pos] == idx) {
+                table[pos] = tombstone;
+                break;
+            }
+        }
+        --used;
+        ++tombstones;
+        objects.erase(idx);
+    }
+    const T& operator[](size_t idx) const { return objects[idx]; }
+    size_t references(size_t idx) const { return objects.is_alive(idx) ? refs[idx] : 0; }
+    size_t unique_objects() const { return used; }
+    // For stats, trimming and scavenging; objects must not be erased or compacted through it
+    any_pool& storage() { return objects; }
+private:
+    static constexpr size_t npos = any_pool::npos;
+    static constexpr size_t empty_slot = npos;
+    static constexpr size_t tombstone = npos - 1;
+    pool<T> objects;
+    std::vector<size_t> refs;   // per slot index
+    std::vector<size_t> hashes; // per slot index
+    std::vector<size_t> table;  // slot indices, size is a power of two
+    size_t used;
+    size_t tombstones;
+    Hash hasher;
+    Eq equal;
+
+    void rehash(size_t new_size) {
+        std::vector<size_t> old(new_size, empty_slot);
+        old.swap(table);
+        size_t mask = table.size() - 1;
+        for (size_t idx : old) {
+            if (idx == empty_slot || idx == tombstone) continue;
+            size_t pos = hashes[idx] & mask;
+            while (table[pos] != empty_slot) pos = (pos + 1) & mask;
+            table[pos] = idx;
+        }
+        tombstones = 0;
+    }
+};
+
+// pool_allocator: allocator over pool slots for std::allocate_shared
+// allocate_shared rebinds the allocator to the library's control block type (counts and
+// T in one object), so every size/alignment that is allocated gets its own
+// pool<pool_storage<Size, Align>> in a pool_resource, sized for exactly that block.
+// A slot keeps its own index in front of the storage, so deallocate() needs no lookup.
+// Single-threaded like pool; the resource must outlive everything allocated from it.
+
+template<size_t Size, size_t Align>
+struct pool_storage {
+    size_t index;
+    alignas(Align) unsigned char bytes[Size];
+};
+
+class pool_resource {
+public:
+    explicit pool_resource(size_t initial_capacity = 1024) : initial_capacity(initial_capacity) {}
+    template<size_t Size, size_t Align>
+    void* allocate() {
+        pool<pool_storage<Size, Align>>& p = pool_for<Size, Align>();
+        size_t idx = p.emplace_uninit();
+        pool_storage<Size, Align>& slot = p[idx];
+        slot.index = idx;
+        return slot.bytes;
+    }
+    template<size_t Size, size_t Align>
+    void deallocate(void* bytes) {
+        using slot_type = pool_storage<Size, Align>;
+        auto* slot = reinterpret_cast<slot_type*>(static_cast<unsigned char*>(bytes) - offsetof(slot_type, bytes));
+        pool_for<Size, Align>().erase(slot->index);
+    }
+    // For stats, trimming and scavenging; slots must not be erased or compacted through it
+    void for_each_pool(const std::function<void(any_pool&)>& f) {
+        for (auto& entry : pools) f(*entry.storage);
+    }
+private:
+    struct pool_entry {
+        size_t size;
+        size_t align;
+        std::unique_ptr<any_pool> storage;
+    };
+    size_t initial_capacity;
+    std::vector<pool_entry> pools; // one per (size, alignment), a handful at most
+
+    template<size_t Size, size_t Align>
+    pool<pool_storage<Size, Align>>& pool_for() {
+        static_assert(Align <= 64, "pool blocks are 64-byte aligned");
+        using storage_pool = pool<pool_storage<Size, Align>>;
+        for (auto& entry : pools) {
+            if (entry.size == Size && entry.align == Align) return static_cast<storage_pool&>(*entry.storage);
+        }
+        pools.push_back({Size, Align, std::make_unique<storage_pool>(initial_capacity)});
+        return static_cast<storage_pool&>(*pools.back().storage);
+    }
+};
+
+template<typename T>
+class pool_allocator {
+public:
+    using value_type = T;
+    explicit pool_allocator(pool_resource& resource) : resource(&resource) {}
+    template<typename U>
+    pool_allocator(const pool_allocator<U>& other) : resource(other.resource) {}
+    // allocate_shared asks for one object; arrays go to operator new
+    T* allocate(size_t n) {
+        if (n != 1) return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        return static_cast<T*>(resource->template allocate<sizeof(T), alignof(T)>());
+    }
+    void deallocate(T* p, size_t n) {
+        if (n != 1) {
+            ::operator delete(p, std::align_val_t(alignof(T)));
+            return;
+        }
+        resource->template deallocate<sizeof(T), alignof(T)>(p);
+    }
+    template<typename U>
+    bool operator==(const pool_allocator<U>& other) const { return resource == other.resource; }
+    template<typename U>
+    bool operator!=(const pool_allocator<U>& other) const { return resource != other.resource; }
+private:
+    template<typename U> friend class pool_allocator;
+    pool_resource* resource;
+};
+
+// Intrusive containers linked by 32-bit pool indices
+// Hooks are members of the pooled objects and hold slot indices, not pointers: half the
+// size of pointer links, no allocation per node, and still meaningful after the pool
+// moves objects. After pool.compact(&remap) (or reorder_by) every container over that
+// pool must be given the same remap once, before it is used again. Unlinking a node does
+// not erase it from the pool, and an object must be unlinked before it is erased.
+// index_list: doubly linked; index_chain: singly linked stack; index_hash: chained
+// hash set keyed by a function of the object, only its bucket array is allocated.
+
+using pool_link = uint32_t;
+constexpr pool_link nil_link = UINT32_MAX;
+
+struct list_hook {
+    pool_link prev = nil_link;
+    pool_link next = nil_link;
+};
+
+struct chain_hook {
+    pool_link next = nil_link;
+};
+
+inline pool_link to_link(size_t idx) {
+    if (idx >= nil_link) throw std::length_error("Pool index does not fit a 32-bit link");
+    return static_cast<pool_link>(idx);
+}
+inline size_t from_link(pool_link link) { return link == nil_link ? any_pool::npos : link; }
+inline pool_link remap_link(pool_link link, const std::vector<size_t>& remap) {
+    return link == nil_link ? nil_link : to_link(remap[link]);
+}
+
+template<typename T, list_hook T::*Hook, typename Pool = pool<T>>
+class index_list {
+public:
+    explicit index_list(Pool& p) : objects(p) {}
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t front() const { return from_link(head); }
+    size_t back() const { return from_link(tail); }
+    size_t next(size_t idx) const { return from_link(hook(idx).next); }
+    size_t prev(size_t idx) const { return from_link(hook(idx).prev); }
+    void push_back(size_t idx) { insert_before(any_pool::npos, idx); }
+    void push_front(size_t idx) { insert_before(front(), idx); }
+    // pos == npos appends
+    void insert_before(size_t pos, size_t idx) {
+        pool_link link = to_link(idx);
+        list_hook& h = hook(idx);
+        h.next = pos == any_pool::npos ? nil_link : to_link(pos);
+        h.prev = pos == any_pool::npos ? tail : hook(pos).prev;
+        if (h.prev == nil_link) head = link; else hook(h.prev).next = link;
+        if (h.next == nil_link) tail = link; else hook(h.next).prev = link;
+        ++count;
+    }
+    void unlink(size_t idx) {
+        list_hook& h = hook(idx);
+        if (h.prev == nil_link) head = h.next; else hook(h.prev).next = h.next;
+        if (h.next == nil_link) tail = h.prev; else hook(h.next).prev = h.prev;
+        h = list_hook{};
+        --count;
+    }
+    template<typename F>
+    void for_each(F&& f) const {
+        for (pool_link i = head; i != nil_link; i = hook(i).next) f(size_t(i));
+    }
+    void remap(const std::vector<size_t>& remap) {
+        head = remap_link(head, remap);
+        tail = remap_link(tail, remap);
+        for (pool_link i = head; i != nil_link; i = hook(i).next) {
+            list_hook& h = hook(i);
+            h.prev = remap_link(h.prev, remap);
+            h.next = remap_link(h.next, remap);
+        }
+    }
+private:
+    Pool& objects;
+    pool_link head = nil_link;
+    pool_link tail = nil_link;
+    size_t count = 0;
+    list_hook& hook(size_t idx) const { return objects[idx].*Hook; }
+};
+
+template<typename T, chain_hook T::*Hook, typename Pool = pool<T>>
+class index_chain {
+public:
+    explicit index_chain(Pool& p) : objects(p) {}
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t front() const { return from_link(head); }
+    size_t next(size_t idx) const { return from_link(hook(idx).next); }
+    void push_front(size_t idx) {
+        hook(idx).next = head;
+        head = to_link(idx);
+        ++count;
+    }
+    size_t pop_front() {
+        if (head == nil_link) throw std::out_of_range("Chain is empty");
+        size_t idx = head;
+        head = hook(idx).next;
+        hook(idx).next = nil_link;
+        --count;
+        return idx;
+    }
+    // O(position): walks from the head
+    bool unlink(size_t idx) {
+        for (pool_link* link = &head; *link != nil_link; link = &hook(*link).next) {
+            if (*link == idx) {
+                *link = hook(idx).next;
+                hook(idx).next = nil_link;
+                --count;
+                return true;
+            }
+        }
+        return false;
+    }
+    template<typename F>
+    void for_each(F&& f) const {
+        for (pool_link i = head; i != nil_link; i = hook(i).next) f(size_t(i));
+    }
+    void remap(const std::vector<size_t>& remap) {
+        head = remap_link(head, remap);
+        for (pool_link i = head; i != nil_link; i = hook(i).next) hook(i).next = remap_link(hook(i).next, remap);
+    }
+private:
+    Pool& objects;
+    pool_link head = nil_link;
+    size_t count = 0;
+    chain_hook& hook(size_t idx) const { return objects[idx].*Hook; }
+};
+
+template<typename T, typename KeyFn, chain_hook T::*Hook, typename Hash = std::hash<std::decay_t<decltype(std::declval<KeyFn>()(std::declval<const T&>()))>>, typename Pool = pool<T>>
+class index_hash {
+public:
+    using key_type = std::decay_t<decltype(std::declval<KeyFn>()(std::declval<const T&>()))>;
+    explicit index_hash(Pool& p, KeyFn key_fn = KeyFn(), size_t initial_buckets = 16)
+        : objects(p), key_of(key_fn), buckets(round_up(initial_buckets), nil_link) {}
+    size_t size() const { return count; }
+    // Duplicate keys are allowed; find() returns the most recently inserted one
+    void insert(size_t idx) {
+        if (count + 1 > buckets.size()) rehash(buckets.size() * 2);
+        pool_link& bucket = buckets[bucket_of(key_of(objects[idx]))];
+        hook(idx).next = bucket;
+        bucket = to_link(idx);
+        ++count;
+    }
+    size_t find(const key_type& key) const {
+        for (pool_link i = buckets[bucket_of(key)]; i != nil_link; i = hook(i).next) {
+            if (key_of(objects[i]) == key) return i;
+        }
+        return any_pool::npos;
+    }
+    bool unlink(size_t idx) {
+        for (pool_link* link = &buckets[bucket_of(key_of(objects[idx]))]; *link != nil_link; link = &hook(*link).next) {
+            if (*link == idx) {
+                *link = hook(idx).next;
+                hook(idx).next = nil_link;
+                --count;
+                return true;
+            }
+        }
+        return false;
+    }
+    void remap(const std::vector<size_t>& remap) {
+        for (pool_link& bucket : buckets) {
+            bucket = remap_link(bucket, remap);
+            for (pool_link i = bucket; i != nil_link; i = hook(i).next) hook(i).next = remap_link(hook(i).next, remap);
+        }
+    }
+private:
+    Pool& objects;
+    KeyFn key_of;
+    Hash hasher;
+    std::vector<pool_link> buckets; // chain heads, size is a power of two
+    size_t count = 0;
+
+    static size_t round_up(size_t n) {
+        size_t size = 1;
+        while (size < n) size *= 2;
+        return size;
+    }
+    size_t bucket_of(const key_type& key) const { return hasher(key) & (buckets.size() - 1); }
+    chain_hook& hook(size_t idx) const { return objects[idx].*Hook; }
+    void rehash(size_t new_size) {
+        std::vector<pool_link> old(new_size, nil_link);
+        old.swap(buckets);
+        for (pool_link head : old) {
+            for (pool_link i = head; i != nil_link;) {
+                pool_link next = hook(i).next;
+                pool_link& bucket = buckets[bucket_of(key_of(objects[i]))];
+                hook(i).next = bucket;
+                bucket = i;
+                i = next;
+            }
+        }
+    }
+};
+
+// Bounded lock-free ring queues for handing pooled objects between threads
+// A stage passes a pool_handle (8 bytes, the object address resolved by the owning
+// thread) instead of copying the object. Consumers read the object through the handle
+// and never touch the pool's index tables, which the owning thread keeps mutating; the
+// owner erases an object once its handle comes back (pool::index_of). A queue built
+// with a source pool registers with it, and compact()/reorder_by() throw while any
+// registered queue holds a handle. Capacity is rounded up to a power of two.
+// spsc_queue: one producer, one consumer (Lamport ring, each side caches the other's index).
+// mpmc_queue: any number of each (per-cell sequence numbers, Vyukov's bounded queue).
+
+inline size_t ring_capacity(size_t n) {
+    size_t size = 1;
+    while (size < n) size *= 2;
+    return size;
+}
+
+template<typename E>
+class spsc_queue final : public handle_queue {
+    static_assert(std::is_trivially_copyable_v<E>, "queue elements are copied by value");
+public:
+    explicit spsc_queue(size_t capacity, any_pool* source = nullptr)
+        : cells(ring_capacity(capacity)), mask(cells.size() - 1), source(source) {
+        if (source) source->attach_queue(this);
+    }
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+    ~spsc_queue() {
+        if (source) source->detach_queue(this);
+    }
+    // Producer thread only
+    bool try_push(const E& e) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head_cache == cells.size()) {
+            head_cache = head.load(std::memory_order_acquire);
+            if (t - head_cache == cells.size()) return false;
+        }
+        cells[t & mask] = e;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    // Consumer thread only
+    bool try_pop(E& e) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail_cache) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if (h == tail_cache) return false;
+        }
+        e = cells[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    size_t in_flight() const override {
+        size_t h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+private:
+    alignas(64) std::atomic<size_t> head{0}; // consumer side
+    size_t tail_cache = 0;
+    alignas(64) std::atomic<size_t> tail{0}; // producer side
+    size_t head_cache = 0;
+    alignas(64) std::vector<E> cells;
+    size_t mask;
+    any_pool* source;
+};
+
+template<typename E>
+class mpmc_queue final : public handle_queue {
+    static_assert(std::is_trivially_copyable_v<E>, "queue elements are copied by value");
+public:
+    explicit mpmc_queue(size_t capacity, any_pool* source = nullptr)
+        : cells(new cell[ring_capacity(capacity)]), mask(ring_capacity(capacity) - 1), source(source) {
+        for (size_t i = 0; i <= mask; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+        if (source) source->attach_queue(this);
+    }
+    mpmc_queue(const mpmc_queue&) = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+    ~mpmc_queue() {
+        if (source) source->detach_queue(this);
+    }
+    bool try_push(const E& e) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        cell* c;
+        while (true) {
+            c = &cells[pos & mask];
+            size_t seq = c->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        c->value = e;
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    bool try_pop(E& e) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        cell* c;
+        while (true) {
+            c = &cells[pos & mask];
+            size_t seq = c->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        e = c->value;
+        c->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+    // Pushes that claimed a cell count as in flight before their value is written
+    size_t in_flight() const override {
+        size_t h = dequeue_pos.load(std::memory_order_acquire);
+        return enqueue_pos.load(std::memory_order_acquire) - h;
+    }
+private:
+    struct alignas(64) cell {
+        std::atomic<size_t> sequence;
+        E value;
+    };
+    std::unique_ptr<cell[]> cells;
+    size_t mask;
+    any_pool* source;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+};
+
+// pool_scavenger: background thread returning idle free memory of watched pools to the OS
+// Every period it visits each watched pool under its maintenance mutex and calls
+// decommit_idle(). A pool whose mutex is busy is skipped until the next wakeup rather
+// than waited for, and at most bytes_per_period are decommitted per wakeup, so the
+// scavenger never holds a pool for long and its madvise traffic stays rate-limited.
+
+class pool_scavenger {
+public:
+    pool_scavenger(std::chrono::milliseconds period, std::chrono::milliseconds min_idle, size_t bytes_per_period)
+        : period(period), min_idle(min_idle), bytes_per_period(bytes_per_period), stopping(false), total(0),
+          worker([this] { run(); }) {}
+    pool_scavenger(const pool_scavenger&) = delete;
+    pool_scavenger& operator=(const pool_scavenger&) = delete;
+    ~pool_scavenger() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_one();
+        worker.join();
+    }
+    // The pool must stay alive until unwatch() or until the scavenger is destroyed
+    void watch(any_pool& p) {
+        std::lock_guard<std::mutex> lock(m);
+        pools.push_back(&p);
+    }
+    void unwatch(any_pool& p) {
+        std::lock_guard<std::mutex> lock(m);
+        pools.erase(std::remove(pools.begin(), pools.end(), &p), pools.end());
+    }
+    size_t scavenged_bytes() const { return total.load(std::memory_order_relaxed); }
+private:
+    std::chrono::milliseconds period;
+    std::chrono::milliseconds min_idle;
+    size_t bytes_per_period;
+    std::mutex m;
+    std::condition_variable cv;
+    bool stopping;
+    std::vector<any_pool*> pools;
+    std::atomic<size_t> total;
+    std::thread worker; // last: starts after the members above are initialized
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m);
+        while (!cv.wait_for(lock, period, [this] { return stopping; })) {
+            size_t budget = bytes_per_period;
+            for (any_pool* p : pools) {
+                if (budget == 0) break;
+                std::unique_lock<std::mutex> pool_lock(p->maintenance_mutex(), std::try_to_lock);
+                if (!pool_lock.owns_lock()) continue;
+                size_t released = p->decommit_idle(min_idle, budget);
+                budget -= std::min(budget, released);
+                total.fetch_add(released, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// pressure_monitor: trims watched pools when the system or the cgroup runs short of memory
+// Linux sources, each used when available:
+//  - PSI: a "some <stall> <window>" trigger on /proc/pressure/memory, poll() reports POLLPRI when it fires;
+//  - cgroup v2 memory.events: poll() reports a change when the high/max/oom counters move;
+//  - cgroup v2 memory.current, compared with memory.high (or memory.max) every check_period.
+// On pressure every watched pool is locked (maintenance mutex), trimmed and its free
+// pages decommitted; the reclaimed bytes are passed to the report callback.
+// Elsewhere no thread is started and reclaim() can still be called by hand.
+
+struct pressure_options {
+    std::chrono::microseconds stall{150000};   // PSI: stall time per window that fires the trigger
+    std::chrono::microseconds window{2000000}; // PSI window (unprivileged triggers need a multiple of 2 s)
+    double current_ratio = 0.9;                // memory.current / limit that counts as pressure
+    std::chrono::milliseconds check_period{500};
+    std::string cgroup_dir;                    // empty: this process's cgroup v2 directory
+};
+
+class pressure_monitor {
+public:
+    using report_fn = std::function<void(size_t reclaimed_bytes, const char* reason)>;
+
+    explicit pressure_monitor(report_fn report, pressure_options opt = pressure_options())
+        : report(std::move(report)), opt(std::move(opt)), total(0) {
+#ifdef __linux__
+        if (pipe(wake) != 0) wake[0] = wake[1] = -1;
+        open_psi();
+        open_cgroup();
+        if (wake[0] >= 0) worker = std::thread([this] { run(); });
+#endif
+    }
+    pressure_monitor(const pressure_monitor&) = delete;
+    pressure_monitor& operator=(const pressure_monitor&) = delete;
+    ~pressure_monitor() {
+#ifdef __linux__
+        if (worker.joinable()) {
+            char c = 0;
+            if (write(wake[1], &c, 1) < 0) {}
+            worker.join();
+        }
+        for (int fd : {psi_fd, events_fd, wake[0], wake[1]}) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+    // The pool must stay alive until unwatch() or until the monitor is destroyed
+    void watch(any_pool& p) {
+        std::lock_guard<std::mutex> lock(m);
+        pools.push_back(&p);
+    }
+    void unwatch(any_pool& p) {
+        std::lock_guard<std::mutex> lock(m);
+        pools.erase(std::remove(pools.begin(), pools.end(), &p), pools.end());
+    }
+    // Releases empty blocks and decommits free pages of every watched pool
+    size_t reclaim(const char* reason) {
+        size_t reclaimed = 0;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            for (any_pool* p : pools) {
+                std::lock_guard<std::mutex> pool_lock(p->maintenance_mutex());
+                reclaimed += p->trim();
+                reclaimed += p->decommit_idle(std::chrono::steady_clock::duration::zero(), size_t(-1));
+            }
+        }
+        total.fetch_add(reclaimed, std::memory_order_relaxed);
+        if (report) report(reclaimed, reason);
+        return reclaimed;
+    }
+    size_t reclaimed_bytes() const { return total.load(std::memory_order_relaxed); }
+    bool psi_available() const { return psi_fd >= 0; }
+    bool cgroup_available() const { return events_fd >= 0; }
+private:
+    report_fn report;
+    pressure_options opt;
+    std::mutex m;
+    std::vector<any_pool*> pools;
+    std::atomic<size_t> total;
+    int psi_fd = -1;
+    int events_fd = -1;
+    int wake[2] = {-1, -1};
+    size_t limit_events = 0; // high + max + oom from memory.events
+    std::string cgroup;
+    std::thread worker;
+
+#ifdef __linux__
+    static bool read_file(const std::string& path, std::string& out) {
+        FILE* f = std::fopen(path.c_str(), "r");
+        if (!f) return false;
+        char buf[4096];
+        size_t n = std::fread(buf, 1, sizeof(buf) - 1, f);
+        std::fclose(f);
+        out.assign(buf, n);
+        return true;
+    }
+    void open_psi() {
+        psi_fd = open("/proc/pressure/memory", O_RDWR | O_NONBLOCK);
+        if (psi_fd < 0) return;
+        std::string trigger = "some " + std::to_string(opt.stall.count()) + " " + std::to_string(opt.window.count());
+        if (write(psi_fd, trigger.c_str(), trigger.size() + 1) < 0) {
+            close(psi_fd);
+            psi_fd = -1;
+        }
+    }
+    void open_cgroup() {
+        cgroup = opt.cgroup_dir;
+        if (cgroup.empty()) {
+            std::string self;
+            if (!read_file("/proc/self/cgroup", self)) return;
+            size_t pos = self.find("0::");
+            if (pos == std::string::npos) return;
+            size_t end = self.find('\n', pos);
+            cgroup = "/sys/fs/cgroup" + self.substr(pos + 3, end == std::string::npos ? std::string::npos : end - pos - 3);
+        }
+        events_fd = open((cgroup + "/memory.events").c_str(), O_RDONLY);
+        if (events_fd >= 0) limit_events = read_limit_events();
+    }
+    // Re-reading memory.events also re-arms its poll notification
+    size_t read_limit_events() {
+        char buf[1024];
+        ssize_t n = pread(events_fd, buf, sizeof(buf) - 1, 0);
+        if (n <= 0) return limit_events;
+        buf[n] = 0;
+        size_t sum = 0;
+        for (const char* key : {"high ", "max ", "oom "}) {
+            const char* at = std::strstr(buf, key);
+            if (at && (at == buf || at[-1] == '\n')) sum += std::strtoull(at + std::strlen(key), nullptr, 10);
+        }
+        return sum;
+    }
+    bool over_current_ratio() {
+        std::string current, limit;
+        if (cgroup.empty() || !read_file(cgroup + "/memory.current", current)) return false;
+        if (!read_file(cgroup + "/memory.high", limit) || limit.compare(0, 3, "max") == 0) {
+            if (!read_file(cgroup + "/memory.max", limit) || limit.compare(0, 3, "max") == 0) return false;
+        }
+        double used = std::strtod(current.c_str(), nullptr);
+        double cap = std::strtod(limit.c_str(), nullptr);
+        return cap > 0 && used / cap >= opt.current_ratio;
+    }
+    void run() {
+        while (true) {
+            pollfd fds[3] = {{wake[0], POLLIN, 0}, {psi_fd, POLLPRI, 0}, {events_fd, POLLPRI, 0}};
+            int ready = poll(fds, 3, static_cast<int>(opt.check_period.count()));
+            if (ready < 0 && errno != EINTR) return;
+            if (fds[0].revents) return;
+            if (fds[1].revents & POLLERR) {
+                close(psi_fd);
+                psi_fd = -1; // the PSI file went away, keep the cgroup sources
+            } else if (fds[1].revents & POLLPRI) {
+                reclaim("psi");
+                continue;
+            }
+            if (fds[2].revents & (POLLPRI | POLLERR)) {
+                size_t events = read_limit_events();
+                if (events != limit_events) {
+                    limit_events = events;
+                    reclaim("memory.events");
+                    continue;
+                }
+            }
+            if (ready == 0 && over_current_ratio()) reclaim("memory.current");
+        }
+    }
+#endif
+};
+
+class MyClass {
+    char data[4096]; // 4 KB per object
+    std::string info;
+public:
+    MyClass(int x_, const std::string& s) : info(s) {
+        data[0] = static_cast<char>(x_); // just to use x_
+        // std::cout << "Constructed: " << info << "\n";
     }
     ~MyClass() {
         // std::cout << "Destructed: " << info << "\n";
     }
+    // Reads the first and the last member, i.e. both pages of a 4160-byte object
+    size_t touch() const { return static_cast<size_t>(data[0]) + info.size(); }
     void print() const {
         // std::cout << "MyClass: data[0]=" << int(data[0]) << " info=" << info << "\n";
     }
@@ -183,6 +3379,965 @@ void print_memory_usage() {
 void print_memory_usage() {}
 #endif
 
+// Hardware/software event counter for the benchmarks (perf_event_open on Linux).
+// available() is false when the kernel or the sandbox does not allow it.
+#ifdef __linux__
+class perf_counter {
+public:
+    perf_counter(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~perf_counter() { if (fd >= 0) close(fd); }
+    perf_counter(const perf_counter&) = delete;
+    perf_counter& operator=(const perf_counter&) = delete;
+    bool available() const { return fd >= 0; }
+    void start() {
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    uint64_t stop() {
+        if (fd < 0) return 0;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t value = 0;
+        if (read(fd, &value, sizeof(value)) != sizeof(value)) return 0;
+        return value;
+    }
+    static perf_counter l1d_read_misses() {
+        return perf_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    }
+    static perf_counter dtlb_read_misses() {
+        return perf_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    }
+private:
+    int fd;
+};
+#else
+class perf_counter {
+public:
+    bool available() const { return false; }
+    void start() {}
+    uint64_t stop() { return 0; }
+    static perf_counter l1d_read_misses() { return perf_counter(); }
+    static perf_counter dtlb_read_misses() { return perf_counter(); }
+};
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+size_t minor_page_faults() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_minflt);
+}
+#else
+size_t minor_page_faults() { return 0; }
+#endif
+
+// Small record for the index-math benchmarks: one cache line per element,
+// so the cost measured is addressing, not copying.
+struct Tick {
+    uint64_t id;
+    double price;
+};
+
+// Random operator[] over a cache-resident working set: pool (object_ptrs lookup + checks)
+// against fixed_pool (shift/mask into a fixed directory)
+void bench_fixed_geometry() {
+    constexpr size_t N = size_t(1) << 16;
+    constexpr size_t LOOKUPS = 10000000;
+    std::vector<uint32_t> order(LOOKUPS);
+    std::mt19937 rng(42);
+    for (auto& i : order) i = static_cast<uint32_t>(rng() & (N - 1));
+
+    pool<Tick> dynamic(4);
+    fixed_pool<Tick, 12> fixed(N);
+    for (size_t i = 0; i < N; ++i) {
+        dynamic.push_back(Tick{i, double(i)});
+        fixed.push_back(Tick{i, double(i)});
+    }
+
+    volatile uint64_t checksum = 0;
+    uint64_t sum = 0;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i : order) sum += dynamic[i].id;
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i : order) sum += fixed[i].id;
+    auto t3 = std::chrono::high_resolution_clock::now();
+    checksum += sum;
+    auto ns_dynamic = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+    auto ns_fixed = std::chrono::duration_cast<std::chrono::nanoseconds>(t3 - t2).count();
+    std::cout << "random operator[] (" << N << " objects): pool avg " << (ns_dynamic / double(LOOKUPS))
+              << " ns, fixed_pool avg " << (ns_fixed / double(LOOKUPS)) << " ns per op\n";
+    std::cout << "Checksum: " << checksum << " (ignore, prevents optimization)\n";
+}
+
+// 4 KB plain buffer, overwritten by the producer right after it is placed in the pool
+struct Payload {
+    char data[4096];
+};
+
+// push_back() value-initializes (zeroes) the buffer before the producer overwrites it;
+// emplace_uninit() leaves it alone, so every byte is written once. The pools are
+// pre-faulted (enable_realtime) and small enough to stay in L2, and are refilled
+// ROUNDS times: otherwise page faults and DRAM writes dominate both loops.
+void bench_uninit_emplace() {
+    constexpr size_t N = 256;
+    constexpr size_t ROUNDS = 400;
+    auto fill = [](Payload& p, size_t i) { std::memset(p.data, static_cast<int>(i), sizeof(p.data)); };
+    auto run = [&](auto&& emplace_one) {
+        pool<Payload> p(N);
+        p.enable_realtime(N);
+        std::vector<size_t> idx(N);
+        long long ns = 0;
+        for (size_t r = 0; r < ROUNDS; ++r) {
+            auto t1 = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < N; ++i) {
+                idx[i] = emplace_one(p);
+                fill(p[idx[i]], i);
+            }
+            auto t2 = std::chrono::high_resolution_clock::now();
+            ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+            for (size_t i : idx) p.erase(i);
+        }
+        return ns / double(N * ROUNDS);
+    };
+    double ns_zeroed = run([](pool<Payload>& p) { return p.emplace(); });
+    double ns_uninit = run([](pool<Payload>& p) { return p.emplace_uninit(); });
+    std::cout << "emplace()+fill: avg " << ns_zeroed << " ns, emplace_uninit()+fill: avg "
+              << ns_uninit << " ns per 4 KB object\n";
+}
+
+// 8-byte record: an id plus flags, the kind of object packed_pool is for
+struct SmallRecord {
+    uint32_t id;
+    uint32_t flags;
+};
+
+// Memory per object and push_back cost: pool pads every object to 64 bytes
+// and keeps an 8-byte object_ptrs entry, packed_pool stores 8 bytes + 1 bit
+void bench_packed_small() {
+    constexpr size_t N = 2000000;
+    pool<SmallRecord> padded(1024);
+    packed_pool<SmallRecord> packed;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N; ++i) padded.push_back(SmallRecord{uint32_t(i), 0});
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N; ++i) packed.push_back(SmallRecord{uint32_t(i), 0});
+    auto t3 = std::chrono::high_resolution_clock::now();
+    auto ns_padded = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+    auto ns_packed = std::chrono::duration_cast<std::chrono::nanoseconds>(t3 - t2).count();
+    // object_ptrs is not part of committed_bytes, add it for pool
+    double padded_bytes = (padded.stats().committed_bytes + N * sizeof(void*)) / double(N);
+    double packed_bytes = packed.stats().committed_bytes / double(N);
+    std::cout << "small objects: pool " << padded_bytes << " bytes/object, push_back avg " << (ns_padded / double(N))
+              << " ns; packed_pool " << packed_bytes << " bytes/object, push_back avg " << (ns_packed / double(N)) << " ns\n";
+}
+
+// One page per object: without coloring the stride is exactly 4096 bytes
+struct Page {
+    char data[4096];
+};
+
+// Reads the first byte of every object in a 2 MB pool, over and over.
+// Uncolored, all 512 lines land in one L1 set and a handful of L2 sets;
+// colored (stride 4160), they spread over all sets and stay cache resident.
+void bench_stride_coloring() {
+    constexpr size_t N = 512;
+    constexpr size_t PASSES = 2000;
+    pool<Page, pool_layout<Page, false>> plain(N);
+    pool<Page> colored(N);
+    for (size_t i = 0; i < N; ++i) {
+        plain[plain.emplace_uninit()].data[0] = static_cast<char>(i);
+        colored[colored.emplace_uninit()].data[0] = static_cast<char>(i);
+    }
+    auto run = [&](auto& p, const char* name) {
+        std::vector<const char*> fields(N);
+        for (size_t i = 0; i < N; ++i) fields[i] = &p[i].data[0];
+        perf_counter misses = perf_counter::l1d_read_misses();
+        volatile uint64_t checksum = 0;
+        uint64_t sum = 0;
+        misses.start();
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (size_t pass = 0; pass < PASSES; ++pass) {
+            for (const char* f : fields) sum += *f;
+        }
+        auto t2 = std::chrono::high_resolution_clock::now();
+        uint64_t miss_count = misses.stop();
+        checksum += sum;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+        std::cout << name << " (stride " << p.stats().element_size << "): avg " << (ns / double(N * PASSES)) << " ns per field read";
+        if (misses.available()) std::cout << ", " << (miss_count / double(N * PASSES)) << " L1D misses per read";
+        std::cout << "\n";
+    };
+    run(plain, "field scan, uncolored");
+    run(colored, "field scan, colored");
+}
+
+// MyClass objects (4160 bytes) in the default layout against page_run_layout:
+// first-touch faults per object while constructing, dTLB misses per object
+// while touching both ends of every object in random order. Each layout runs once
+// sized up front and once grown from 4 objects, which must not commit runs it can't use
+void bench_page_runs() {
+    constexpr size_t N = 20000;
+    std::vector<uint32_t> order(N);
+    for (size_t i = 0; i < N; ++i) order[i] = static_cast<uint32_t>(i);
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+    auto run = [&](auto& p, const char* name) {
+        size_t faults = minor_page_faults();
+        for (size_t i = 0; i < N; ++i) p.push_back(static_cast<int>(i), "PoolFabric#" + std::to_string(i));
+        faults = minor_page_faults() - faults;
+        perf_counter tlb = perf_counter::dtlb_read_misses();
+        volatile size_t checksum = 0;
+        size_t sum = 0;
+        tlb.start();
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (uint32_t i : order) sum += p[i].touch();
+        auto t2 = std::chrono::high_resolution_clock::now();
+        uint64_t tlb_misses = tlb.stop();
+        checksum += sum;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+        std::cout << name << ": " << (faults / double(N)) << " faults per object, random touch avg " << (ns / double(N)) << " ns";
+        if (tlb.available()) std::cout << ", " << (tlb_misses / double(N)) << " dTLB misses per object";
+        std::cout << ", " << p.stats().committed_bytes / (1024.0 * 1024.0) << " MB committed\n";
+    };
+    {
+        pool<MyClass> packed(N);
+        run(packed, "MyClass, default layout");
+    }
+    {
+        pool<MyClass, page_run_layout<MyClass>> runs(N);
+        run(runs, "MyClass, page_run_layout");
+    }
+    {
+        pool<MyClass> packed(4);
+        run(packed, "MyClass, default layout from 4");
+    }
+    {
+        pool<MyClass, page_run_layout<MyClass>> runs(4);
+        run(runs, "MyClass, page_run_layout from 4");
+    }
+}
+
+// Growth and random access with one reserved range: push_back commits 2 MB chunks
+// in place, operator[] is base + i * stride
+void bench_reserved_range() {
+    constexpr size_t N = 2000000;
+    constexpr size_t LOOKUPS = 10000000;
+    pool<Tick> blocks(1024);
+    reserved_pool<Tick> reserved(size_t(1) << 30); // 64 GB of address space, committed on demand
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N; ++i) blocks.push_back(Tick{i, double(i)});
+    auto t2 = std::chrono::high_resolution_clock::now();
+    const Tick* first = &reserved[reserved.emplace(Tick{0, 0.0})];
+    for (size_t i = 1; i < N; ++i) reserved.push_back(Tick{i, double(i)});
+    auto t3 = std::chrono::high_resolution_clock::now();
+    std::vector<uint32_t> order(LOOKUPS);
+    std::mt19937 rng(42);
+    for (auto& i : order) i = static_cast<uint32_t>(rng() % N);
+    volatile uint64_t checksum = 0;
+    uint64_t sum = 0;
+    auto t4 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i : order) sum += blocks[i].id;
+    auto t5 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i : order) sum += reserved[i].id;
+    auto t6 = std::chrono::high_resolution_clock::now();
+    checksum += sum;
+    auto ns = [](auto a, auto b) { return std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count(); };
+    std::cout << "push_back: pool avg " << (ns(t1, t2) / double(N)) << " ns, reserved_pool avg " << (ns(t2, t3) / double(N)) << " ns per op\n";
+    std::cout << "random operator[] (" << N << " objects): pool avg " << (ns(t4, t5) / double(LOOKUPS))
+              << " ns, reserved_pool avg " << (ns(t5, t6) / double(LOOKUPS)) << " ns per op\n";
+    std::cout << "reserved_pool: first object " << (first == &reserved[0] ? "did not move" : "MOVED") << " while growing, "
+              << reserved.stats().committed_bytes / (1024.0 * 1024.0) << " MB committed\n";
+}
+
+// Erase three objects out of every four in a 4 KB-object pool and let the scavenger
+// return the freed pages once the pool has been quiet for min_idle
+void demo_scavenger() {
+    constexpr size_t N = 20000;
+    pool<Payload> p(N);
+    for (size_t i = 0; i < N; ++i) std::memset(p[p.emplace_uninit()].data, 1, sizeof(Payload::data));
+    pool_scavenger scavenger(std::chrono::milliseconds(10), std::chrono::milliseconds(50), size_t(16) << 20);
+    scavenger.watch(p);
+    {
+        std::lock_guard<std::mutex> lock(p.maintenance_mutex());
+        for (size_t i = 0; i < N; ++i) {
+            if (i % 4 != 0) p.erase(i);
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    {
+        std::lock_guard<std::mutex> lock(p.maintenance_mutex());
+        print_pool_stats("scavenged", p);
+    }
+    scavenger.unwatch(p);
+}
+
+// Pressure monitor over a pool with freed memory: the kernel sources are polled in the
+// background, reclaim() runs the same trimming path on demand
+void demo_pressure_monitor() {
+    constexpr size_t N = 20000;
+    pool<Payload> p(N);
+    for (size_t i = 0; i < N; ++i) std::memset(p[p.emplace_uninit()].data, 1, sizeof(Payload::data));
+    for (size_t i = 0; i < N; ++i) {
+        if (i % 4 != 0) p.erase(i);
+    }
+    pressure_monitor monitor([](size_t bytes, const char* reason) {
+        std::cout << "[pressure] " << reason << ": reclaimed " << bytes / (1024.0 * 1024.0) << " MB\n";
+    });
+    std::cout << "[pressure] PSI trigger " << (monitor.psi_available() ? "armed" : "unavailable")
+              << ", cgroup v2 memory.events " << (monitor.cgroup_available() ? "watched" : "unavailable") << "\n";
+    monitor.watch(p);
+    monitor.reclaim("manual");
+    monitor.unwatch(p);
+}
+
+// 200000 interned configuration strings with 1000 distinct values: only the distinct
+// values are stored, the rest are references to them
+void bench_intern() {
+    constexpr size_t N = 200000;
+    intern_pool<std::string> configs(1024);
+    std::vector<size_t> handles;
+    handles.reserve(N);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N; ++i) handles.push_back(configs.intern("PoolFabric#config-" + std::to_string(i % 1000)));
+    auto t2 = std::chrono::high_resolution_clock::now();
+    size_t distinct = configs.unique_objects();
+    for (size_t h : handles) configs.release(h);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+    std::cout << "intern: avg " << (ns / double(N)) << " ns per op, " << N << " handles to " << distinct
+              << " stored objects, " << configs.unique_objects() << " left after releasing all\n";
+}
+
+// 64 populated ranges of 1000 ids at random places in a 2^40 id space
+void bench_sparse_ids() {
+    constexpr size_t RANGES = 64;
+    constexpr size_t PER_RANGE = 1000;
+    constexpr size_t LOOKUPS = 10000000;
+    sparse_pool<Tick> ticks;
+    std::mt19937_64 rng(11);
+    std::vector<uint64_t> ids;
+    for (size_t r = 0; r < RANGES; ++r) {
+        uint64_t base = rng() & sparse_pool<Tick>::max_id & ~uint64_t(0xFFFF);
+        for (size_t i = 0; i < PER_RANGE; ++i) ids.push_back(base + i);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (uint64_t id : ids) ticks.emplace_at(id, Tick{id, double(id)});
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::vector<uint64_t> order(LOOKUPS);
+    for (auto& id : order) id = ids[rng() % ids.size()];
+    volatile uint64_t checksum = 0;
+    uint64_t sum = 0;
+    auto t3 = std::chrono::high_resolution_clock::now();
+    for (uint64_t id : order) sum += ticks[id].id;
+    auto t4 = std::chrono::high_resolution_clock::now();
+    checksum += sum;
+    auto ns_emplace = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+    auto ns_lookup = std::chrono::duration_cast<std::chrono::nanoseconds>(t4 - t3).count();
+    std::cout << "sparse ids: emplace_at avg " << (ns_emplace / double(ids.size())) << " ns, operator[] avg "
+              << (ns_lookup / double(LOOKUPS)) << " ns per op\n";
+    print_pool_stats("sparse", ticks);
+}
+
+// Three tenants sharing one pool, the third one capped at 1 MB
+void demo_tenant_tags() {
+    pool<Tick> shared(1024);
+    constexpr pool_tag tenants[] = {1, 2, 3};
+    shared.set_tag_quota(3, size_t(1) << 20);
+    size_t rejected = 0;
+    for (size_t i = 0; i < 60000; ++i) {
+        try {
+            shared.emplace_tagged(tenants[i % 3], Tick{i, double(i)});
+        } catch (const std::length_error&) {
+            ++rejected;
+        }
+    }
+    for (size_t i = 0; i < 30000; i += 2) shared.erase(i);
+    for (pool_tag tag : tenants) {
+        tag_usage u = shared.usage(tag);
+        std::cout << "[tenant " << tag << "] " << u.live << " objects, " << u.bytes / 1024.0 << " KB";
+        if (u.quota_bytes) std::cout << " (quota " << u.quota_bytes / 1024.0 << " KB)";
+        std::cout << "\n";
+    }
+    std::cout << "[tenant 3] " << rejected << " emplaces rejected by quota\n";
+}
+
+// push_back latency distribution with synchronous growth and with the next block
+// allocated and pre-faulted in the background once the pool is 50% full. The slowest
+// push_back that grew the pool is reported apart: the overall max also includes the
+// object_ptrs reallocation at powers of two, which both modes pay
+void bench_background_growth() {
+    constexpr size_t N = 4000000;
+    auto run = [&](bool background, const char* name) {
+        pool<Tick> p(1024);
+        if (background) p.enable_background_growth(0.5, true);
+        std::vector<uint32_t> latencies(N);
+        uint32_t grow_max = 0;
+        for (size_t i = 0; i < N; ++i) {
+            size_t capacity = p.capacity();
+            auto t1 = std::chrono::steady_clock::now();
+            p.push_back(Tick{i, double(i)});
+            auto t2 = std::chrono::steady_clock::now();
+            latencies[i] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count());
+            if (p.capacity() != capacity) grow_max = std::max(grow_max, latencies[i]);
+            // Give the helper thread time to run, as a real producer between inserts would
+            if (background && (i & 1023) == 0) std::this_thread::yield();
+        }
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << name << ": push_back p50 " << latencies[N / 2] << " ns, p99.99 " << latencies[N - N / 10000]
+                  << " ns, max " << latencies.back() << " ns, slowest grow " << grow_max << " ns\n";
+    };
+    run(false, "synchronous growth");
+    run(true, "background growth");
+}
+
+// Worst-case operation cost after enable_realtime(): random push_back/erase churn over a
+// pool that never grows, checked against a latency bound
+void bench_realtime() {
+    constexpr size_t CAPACITY = 1000000;
+    constexpr size_t OPS = 4000000;
+    constexpr long long BOUND_NS = 20000;
+    pool<Tick> p(1024);
+    p.enable_realtime(CAPACITY, [](const char* what) { std::cout << "[realtime] violation: " << what << "\n"; });
+    std::vector<size_t> alive_idx;
+    alive_idx.reserve(CAPACITY);
+    for (size_t i = 0; i < CAPACITY / 2; ++i) alive_idx.push_back(p.emplace(Tick{i, 0.0}));
+    std::mt19937 rng(5);
+    std::vector<uint32_t> latencies(OPS);
+    for (size_t i = 0; i < OPS; ++i) {
+        bool insert = alive_idx.size() < CAPACITY / 4 || (alive_idx.size() < CAPACITY && (rng() & 1));
+        size_t victim = rng() % alive_idx.size();
+        auto t1 = std::chrono::steady_clock::now();
+        if (insert) {
+            alive_idx.push_back(p.emplace(Tick{i, 0.0}));
+        } else {
+            p.erase(alive_idx[victim]);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        if (!insert) {
+            alive_idx[victim] = alive_idx.back();
+            alive_idx.pop_back();
+        }
+        latencies[i] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count());
+    }
+    // Same measurement around an empty region: outliers here are preemption and timer noise
+    size_t noise = 0;
+    for (size_t i = 0; i < OPS; ++i) {
+        auto t1 = std::chrono::steady_clock::now();
+        auto t2 = std::chrono::steady_clock::now();
+        noise += std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() > BOUND_NS;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    size_t over = static_cast<size_t>(latencies.end() - std::upper_bound(latencies.begin(), latencies.end(), uint32_t(BOUND_NS)));
+    std::cout << "realtime churn: p50 " << latencies[OPS / 2] << " ns, p99.99 " << latencies[OPS - OPS / 10000]
+              << " ns, max " << latencies.back() << " ns; " << over << " ops over the " << BOUND_NS << " ns bound ("
+              << noise << " over it with an empty timed region), " << p.stats().realtime_violations << " violations\n";
+}
+
+// mlock'ed pool growing past RLIMIT_MEMLOCK: early blocks are locked, later ones fall back
+void demo_memory_lock() {
+#if defined(__linux__) || defined(__APPLE__)
+    rlimit limit;
+    getrlimit(RLIMIT_MEMLOCK, &limit);
+    std::cout << "[mlock] RLIMIT_MEMLOCK " << (limit.rlim_cur == RLIM_INFINITY ? std::string("unlimited") : std::to_string(limit.rlim_cur / 1024) + " KB") << "\n";
+#endif
+    pool<Payload> p(256);
+    p.set_memory_lock(true);
+    for (size_t i = 0; i < 8000; ++i) p.emplace_uninit();
+    print_pool_stats("locked", p);
+}
+
+// Batch producer: per-object emplace vs claim(n) + in-place construction + publish()
+void bench_claim_batches() {
+    const size_t N = 1 << 20, batch = 1024;
+    pool<Tick> single(4096);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N; ++i) single.emplace(Tick{i, double(i)});
+    auto t2 = std::chrono::high_resolution_clock::now();
+    pool<Tick> batched(4096);
+    auto t3 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N; i += batch) {
+        pool_claim<Tick> c = batched.claim(batch);
+        for (size_t j = 0; j < c.size; ++j) new (c.place(j)) Tick{i + j, double(i + j)};
+        batched.publish(c);
+    }
+    auto t4 = std::chrono::high_resolution_clock::now();
+    auto ns_single = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+    auto ns_batched = std::chrono::duration_cast<std::chrono::nanoseconds>(t4 - t3).count();
+    std::cout << "emplace(): avg " << (ns_single / double(N)) << " ns per op, claim(" << batch << ")+publish(): avg "
+              << (ns_batched / double(N)) << " ns per op\n";
+    print_pool_stats("claimed", batched);
+}
+
+// Occupancy kernels: every variant the CPU supports on the same bitmaps, then a pool
+// count via the bitmap vs the per-slot is_alive() walk over object_ptrs
+void bench_occupancy_kernels() {
+    const size_t words = 1 << 15; // 2M slots, 256 KB per bitmap
+    const int rounds = 200;
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> occupied(words), predicate(words), selected(words), sparse(words, 0);
+    for (size_t i = 0; i < words; ++i) {
+        occupied[i] = rng();
+        predicate[i] = rng();
+    }
+    sparse[words - 1] = uint64_t(1) << 63; // worst case for find_first: scan everything
+    for (const occupancy_kernel_set& k : occupancy_kernel_variants()) {
+        size_t sink = 0;
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < rounds; ++r) sink += k.popcount(occupied.data(), words);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < rounds; ++r) sink += k.find_first(sparse.data(), words, 0);
+        auto t3 = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < rounds; ++r) sink += k.and_count(selected.data(), occupied.data(), predicate.data(), words);
+        auto t4 = std::chrono::high_resolution_clock::now();
+        double per_word = 1.0 / (double(rounds) * words);
+        std::cout << "[occupancy] " << k.name << ": popcount avg "
+                  << std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() * per_word << " ns, find_first avg "
+                  << std::chrono::duration_cast<std::chrono::nanoseconds>(t3 - t2).count() * per_word << " ns, and_count avg "
+                  << std::chrono::duration_cast<std::chrono::nanoseconds>(t4 - t3).count() * per_word
+                  << " ns per 64-slot word (checksum " << sink << ")\n";
+    }
+    std::cout << "[occupancy] selected: " << occupancy_kernels().name << "\n";
+
+    const size_t N = 1 << 20;
+    pool<SmallRecord> p(N);
+    for (size_t i = 0; i < N; ++i) p.emplace(SmallRecord{uint32_t(i), 0});
+    for (size_t i = 0; i < N; i += 3) p.erase(i);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    size_t walked = 0;
+    for (size_t i = 0; i < p.size(); ++i) walked += p.is_alive(i);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    size_t counted = p.count_alive(0, p.size());
+    auto t3 = std::chrono::high_resolution_clock::now();
+    std::cout << "is_alive() walk: " << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count()
+              << " us, count_alive(): " << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count()
+              << " us (" << walked << " / " << counted << " alive)\n";
+}
+
+// Range scan in key order over objects placed in random order, before and after reorder_by()
+void bench_reorder_by_key() {
+    const size_t N = 1 << 19;
+    pool<Tick> p(N);
+    std::vector<uint64_t> ids(N);
+    for (size_t i = 0; i < N; ++i) ids[i] = i;
+    std::shuffle(ids.begin(), ids.end(), std::mt19937_64(7));
+    std::vector<size_t> where(N); // id -> pool index
+    for (size_t i = 0; i < N; ++i) where[ids[i]] = p.emplace(Tick{ids[i], double(ids[i])});
+    auto scan = [&] {
+        double sum = 0;
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (size_t id = 0; id < N; ++id) sum += p[where[id]].price;
+        auto t2 = std::chrono::high_resolution_clock::now();
+        std::cout << "  scan by id: avg " << std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() / double(N)
+                  << " ns per op (sum " << sum << ")\n";
+    };
+    std::cout << "[reorder] shuffled placement\n";
+    scan();
+    std::vector<size_t> remap;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    p.reorder_by([](const Tick& t) { return t.id; }, &remap);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (size_t& idx : where) idx = remap[idx];
+    std::cout << "[reorder] reorder_by(id) of " << N << " objects in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << " us\n";
+    scan();
+}
+
+// Random field updates in batches: one operator[] per update vs scatter()/gather(),
+// for a small batch and for one that covers a quarter of the pool
+void bench_scatter_gather() {
+    const size_t N = 1 << 20, ops = 1 << 20;
+    pool<Tick> p(N);
+    for (size_t i = 0; i < N; ++i) p.emplace(Tick{i, 0.0});
+    std::mt19937_64 rng(11);
+    for (size_t batch : {size_t(4096), size_t(1) << 18}) {
+        std::vector<std::vector<size_t>> index_batches(ops / batch, std::vector<size_t>(batch));
+        for (auto& b : index_batches) {
+            for (size_t& idx : b) idx = rng() % N;
+        }
+        std::vector<double> prices(batch, 1.5);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (auto& b : index_batches) {
+            for (size_t i = 0; i < batch; ++i) p[b[i]].price = prices[i];
+        }
+        auto t2 = std::chrono::high_resolution_clock::now();
+        for (auto& b : index_batches) p.scatter(b, prices, &Tick::price);
+        auto t3 = std::chrono::high_resolution_clock::now();
+        double sum = 0;
+        for (auto& b : index_batches) {
+            for (size_t i = 0; i < batch; ++i) sum += p[b[i]].price;
+        }
+        auto t4 = std::chrono::high_resolution_clock::now();
+        std::vector<double> out;
+        for (auto& b : index_batches) {
+            p.gather(b, &Tick::price, out);
+            for (double v : out) sum += v;
+        }
+        auto t5 = std::chrono::high_resolution_clock::now();
+        auto ns = [&](auto a, auto b) { return std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count() / double(ops); };
+        std::cout << "batch " << batch << ": operator[] writes avg " << ns(t1, t2) << " ns, scatter avg " << ns(t2, t3)
+                  << " ns, operator[] reads avg " << ns(t3, t4) << " ns, gather avg " << ns(t4, t5) << " ns per op (sum " << sum << ")\n";
+    }
+}
+
+// shared_ptr churn: make_shared (malloc) vs allocate_shared with pool_allocator.
+// Fill a live set, replace random elements (each replacement frees one control block
+// and allocates another), then scan the set
+void bench_allocate_shared() {
+    const size_t N = 1 << 18, replacements = 1 << 20;
+    pool_resource resource;
+    pool_allocator<Tick> alloc(resource);
+    auto run = [&](const char* name, auto make) {
+        std::vector<std::shared_ptr<Tick>> ptrs;
+        ptrs.reserve(N);
+        std::mt19937_64 rng(5);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < N; ++i) ptrs.push_back(make(Tick{i, double(i)}));
+        auto t2 = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < replacements; ++i) {
+            std::shared_ptr<Tick>& p = ptrs[rng() % N];
+            p.reset();
+            p = make(Tick{i, double(i)});
+        }
+        auto t3 = std::chrono::high_resolution_clock::now();
+        double sum = 0;
+        for (auto& p : ptrs) sum += p->price;
+        auto t4 = std::chrono::high_resolution_clock::now();
+        ptrs.clear();
+        auto t5 = std::chrono::high_resolution_clock::now();
+        auto ns = [](auto a, auto b, size_t ops) { return std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count() / double(ops); };
+        std::cout << name << ": create avg " << ns(t1, t2, N) << " ns, replace avg " << ns(t2, t3, replacements)
+                  << " ns, scan avg " << ns(t3, t4, N) << " ns, destroy avg " << ns(t4, t5, N) << " ns per op (sum " << sum << ")\n";
+    };
+    run("make_shared", [](const Tick& t) { return std::make_shared<Tick>(t); });
+    run("allocate_shared(pool_allocator)", [&](const Tick& t) { return std::allocate_shared<Tick>(alloc, t); });
+    resource.for_each_pool([](any_pool& p) { print_pool_stats("shared", p); });
+}
+
+// Orders linked by time (index_list) and by id (index_hash) with 32-bit hooks; half of
+// them are erased, the pool compacted and both containers remapped
+struct Order {
+    uint64_t id;
+    double price;
+    list_hook by_time;
+    chain_hook by_id;
+};
+
+struct order_id {
+    uint64_t operator()(const Order& o) const { return o.id; }
+};
+
+void demo_index_containers() {
+    const size_t N = 1 << 18;
+    pool<Order> orders(N);
+    index_list<Order, &Order::by_time> by_time(orders);
+    index_hash<Order, order_id, &Order::by_id> by_id(orders);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N; ++i) {
+        size_t idx = orders.emplace(Order{i, double(i), {}, {}});
+        by_time.push_back(idx);
+        by_id.insert(idx);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N; i += 2) {
+        size_t idx = by_id.find(i);
+        by_time.unlink(idx);
+        by_id.unlink(idx);
+        orders.erase(idx);
+    }
+    std::vector<size_t> remap;
+    orders.compact(&remap);
+    by_time.remap(remap);
+    by_id.remap(remap);
+    auto t3 = std::chrono::high_resolution_clock::now();
+    size_t in_order = 0, found = 0;
+    uint64_t expected = 1;
+    by_time.for_each([&](size_t idx) {
+        in_order += orders[idx].id == expected;
+        expected += 2;
+    });
+    for (size_t i = 1; i < N; i += 2) found += by_id.find(i) != any_pool::npos && orders[by_id.find(i)].id == i;
+    auto t4 = std::chrono::high_resolution_clock::now();
+    auto ns = [&](auto a, auto b) { return std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count() / double(N); };
+    std::cout << "[index links] hooks " << sizeof(list_hook) << " + " << sizeof(chain_hook) << " bytes per order (pointer hooks: "
+              << 3 * sizeof(void*) << "), link avg " << ns(t1, t2) << " ns, erase half + compact + remap avg " << ns(t2, t3)
+              << " ns, walk + lookup avg " << ns(t3, t4) << " ns per op; " << in_order << " in order, " << found << " found of "
+              << by_time.size() << "\n";
+}
+
+// Stage-to-stage handoff of 4 KB payloads: copying them through an spsc_queue<Payload>
+// vs passing pool_handles (the consumer sends each handle back for the owner to erase),
+// then the handle round trip with two workers on mpmc_queues
+void bench_handoff_queues() {
+    const size_t N = 1 << 16, ring = 256;
+    auto report = [&](const char* name, auto t1, auto t2, uint64_t sum) {
+        double seconds = std::chrono::duration<double>(t2 - t1).count();
+        std::cout << name << ": " << N / seconds / 1e6 << " M items/s, avg " << seconds * 1e9 / N << " ns per item (sum " << sum << ")\n";
+    };
+    {
+        spsc_queue<Payload> q(ring);
+        uint64_t sum = 0;
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::thread consumer([&] {
+            Payload p;
+            for (size_t i = 0; i < N; ++i) {
+                while (!q.try_pop(p)) std::this_thread::yield();
+                sum += static_cast<unsigned char>(p.data[0]);
+            }
+        });
+        Payload p;
+        for (size_t i = 0; i < N; ++i) {
+            std::memset(p.data, static_cast<int>(i), sizeof(p.data));
+            while (!q.try_push(p)) std::this_thread::yield();
+        }
+        consumer.join();
+        report("spsc copy of Payload", t1, std::chrono::high_resolution_clock::now(), sum);
+    }
+    {
+        pool<Payload> objects(ring * 2);
+        spsc_queue<pool_handle<Payload>> work(ring, &objects), done(ring, &objects);
+        uint64_t sum = 0;
+        size_t returned = 0;
+        auto recycle = [&] {
+            pool_handle<Payload> h;
+            while (done.try_pop(h)) {
+                objects.erase(objects.index_of(h.object));
+                ++returned;
+            }
+        };
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::thread consumer([&] {
+            pool_handle<Payload> h;
+            for (size_t i = 0; i < N; ++i) {
+                while (!work.try_pop(h)) std::this_thread::yield();
+                sum += static_cast<unsigned char>(h->data[0]);
+                while (!done.try_push(h)) std::this_thread::yield();
+            }
+        });
+        for (size_t i = 0; i < N; ++i) {
+            recycle();
+            size_t idx = objects.emplace_uninit();
+            std::memset(objects[idx].data, static_cast<int>(i), sizeof(Payload::data));
+            while (!work.try_push(objects.handle(idx))) {
+                recycle();
+                std::this_thread::yield();
+            }
+        }
+        while (returned < N) {
+            recycle();
+            std::this_thread::yield();
+        }
+        consumer.join();
+        report("spsc pool_handle", t1, std::chrono::high_resolution_clock::now(), sum);
+        work.try_push(objects.handle(objects.emplace_uninit()));
+        try {
+            objects.compact(nullptr);
+        } catch (const std::logic_error& e) {
+            std::cout << "[handoff] compact with a handle queued: " << e.what() << "\n";
+        }
+    }
+    {
+        pool<Payload> objects(ring * 2);
+        mpmc_queue<pool_handle<Payload>> work(ring, &objects), done(ring, &objects);
+        std::atomic<size_t> processed{0};
+        std::atomic<uint64_t> sum{0};
+        size_t returned = 0;
+        auto recycle = [&] {
+            pool_handle<Payload> h;
+            while (done.try_pop(h)) {
+                objects.erase(objects.index_of(h.object));
+                ++returned;
+            }
+        };
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> workers;
+        for (int w = 0; w < 2; ++w) {
+            workers.emplace_back([&] {
+                pool_handle<Payload> h;
+                uint64_t local = 0;
+                while (processed.load(std::memory_order_relaxed) < N) {
+                    if (!work.try_pop(h)) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    local += static_cast<unsigned char>(h->data[0]);
+                    while (!done.try_push(h)) std::this_thread::yield();
+                    processed.fetch_add(1, std::memory_order_relaxed);
+                }
+                sum += local;
+            });
+        }
+        for (size_t i = 0; i < N; ++i) {
+            recycle();
+            size_t idx = objects.emplace_uninit();
+            std::memset(objects[idx].data, static_cast<int>(i), sizeof(Payload::data));
+            while (!work.try_push(objects.handle(idx))) {
+                recycle();
+                std::this_thread::yield();
+            }
+        }
+        while (returned < N) {
+            recycle();
+            std::this_thread::yield();
+        }
+        for (auto& w : workers) w.join();
+        report("mpmc pool_handle, 2 workers", t1, std::chrono::high_resolution_clock::now(), sum.load());
+    }
+}
+
+// Temporaries: emplace()+erase() vs lease() on one thread, then four threads sharing a
+// pool: leases (per-thread caches) vs emplace/erase under maintenance_mutex()
+void bench_lease() {
+    const size_t N = 1 << 20, threads = 4;
+    pool<Tick> p(1024);
+    p.emplace(Tick{0, 0.0}); // keeps the block from being released on every erase()
+    double sum = 0;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N; ++i) {
+        size_t idx = p.emplace(Tick{i, 1.0});
+        sum += p[idx].price;
+        p.erase(idx);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N; ++i) {
+        pool_lease<Tick> l = p.lease(Tick{i, 1.0});
+        sum += l->price;
+    }
+    auto t3 = std::chrono::high_resolution_clock::now();
+    auto run_threads = [&](auto body) {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) workers.emplace_back(body);
+        for (auto& w : workers) w.join();
+    };
+    run_threads([&] {
+        for (size_t i = 0; i < N / threads; ++i) {
+            std::lock_guard<std::mutex> lock(p.maintenance_mutex());
+            p.erase(p.emplace(Tick{i, 1.0}));
+        }
+    });
+    auto t4 = std::chrono::high_resolution_clock::now();
+    run_threads([&] {
+        for (size_t i = 0; i < N / threads; ++i) {
+            pool_lease<Tick> l = p.lease(Tick{i, 1.0});
+        }
+    });
+    auto t5 = std::chrono::high_resolution_clock::now();
+    auto ns = [&](auto a, auto b) { return std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count() / double(N); };
+    std::cout << "emplace()+erase(): avg " << ns(t1, t2) << " ns, lease(): avg " << ns(t2, t3) << " ns per op (sum " << sum << ")\n";
+    std::cout << threads << " threads, locked emplace()+erase(): avg " << ns(t3, t4) << " ns, lease(): avg " << ns(t4, t5) << " ns per op\n";
+    print_pool_stats("leases", p);
+    p.flush_lease_caches();
+    print_pool_stats("flushed", p);
+}
+
+// Free-slot poisoning: in an ASan build (-fsanitize=address) a stale pointer into an
+// erased slot is reported as use-after-poison; here ASan is asked about it directly
+void demo_asan_poisoning() {
+    pool<Tick> p(8);
+    size_t first = p.emplace(Tick{1, 1.0});
+    p.emplace(Tick{2, 2.0});
+    const Tick* stale = &p[first];
+    p.erase(first);
+#ifdef POOL_ASAN
+    std::cout << "[asan] erased slot poisoned: " << (__asan_address_is_poisoned(stale) ? "yes" : "no");
+    size_t reused = p.emplace(Tick{3, 3.0});
+    std::cout << ", slot " << reused << " poisoned after reuse: " << (__asan_address_is_poisoned(&p[reused]) ? "yes" : "no") << "\n";
+#else
+    (void)stale;
+    std::cout << "[asan] not an ASan build, free-slot poisoning is compiled out\n";
+#endif
+}
+
+// Growth policies on three workloads: one pool filled in a burst, a long-lived pool
+// under insert/erase churn that slowly grows, and many short-lived small pools.
+// Grows are counted and waste is capacity not holding a live object at the end.
+void bench_growth_policies() {
+    struct policy_case { growth_policy policy; const char* name; };
+    const policy_case cases[] = {{growth_policy::doubling, "doubling"}, {growth_policy::fixed, "fixed"}, {growth_policy::adaptive, "adaptive"}};
+    auto report = [](const char* workload, const char* name, double ms, const pool_stats& s) {
+        std::cout << workload << ", " << name << ": " << ms << " ms, " << s.grows << " grows, capacity " << s.capacity
+                  << " for " << s.live << " live (" << (s.capacity ? 100.0 * (s.capacity - s.live) / s.capacity : 0.0) << "% waste)";
+        if (s.growth_limit) std::cout << ", last block " << s.growth_block << " (" << s.growth_limit << ")";
+        std::cout << "\n";
+    };
+    for (auto& c : cases) {
+        pool<Tick> p(1024);
+        p.set_growth_policy(c.policy);
+        auto t1 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < 100000; ++i) p.push_back(Tick{i, 1.0});
+        auto t2 = std::chrono::steady_clock::now();
+        report("burst", c.name, std::chrono::duration<double, std::milli>(t2 - t1).count(), p.stats());
+    }
+    for (auto& c : cases) {
+        pool<Tick> p(1024);
+        p.set_growth_policy(c.policy);
+        std::vector<size_t> alive_idx;
+        std::mt19937 rng(11);
+        auto t1 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < 300000; ++i) {
+            alive_idx.push_back(p.emplace(Tick{i, 1.0}));
+            if (i % 5 != 0) {
+                size_t victim = rng() % alive_idx.size();
+                p.erase(alive_idx[victim]);
+                alive_idx[victim] = alive_idx.back();
+                alive_idx.pop_back();
+            }
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        report("churn", c.name, std::chrono::duration<double, std::milli>(t2 - t1).count(), p.stats());
+    }
+    for (auto& c : cases) {
+        size_t grows = 0, capacity = 0, live = 0;
+        auto t1 = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < 4; ++r) {
+            pool<Tick> p(4);
+            p.set_growth_policy(c.policy);
+            for (size_t i = 0; i < 20 + 10 * r; ++i) p.push_back(Tick{i, 1.0});
+            pool_stats s = p.stats();
+            grows += s.grows;
+            capacity += s.capacity;
+            live += s.live;
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        std::cout << "small pools, " << c.name << ": " << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms, "
+                  << grows << " grows, capacity " << capacity << " for " << live << " live ("
+                  << 100.0 * (capacity - live) / capacity << "% waste)\n";
+    }
+}
+
+// Management code that only sees any_pool: stats, compaction and trimming
+// over pools of unrelated element types
+void demo_any_pool() {
+    pool<Tick> ticks(1024);
+    fixed_pool<std::string, 10> names(size_t(1) << 14);
+    for (size_t i = 0; i < 10000; ++i) {
+        ticks.push_back(Tick{i, double(i)});
+        names.push_back("PoolFabric#" + std::to_string(i));
+    }
+    for (size_t i = 0; i < 10000; i += 3) {
+        ticks.erase(i);
+        names.erase(i);
+    }
+    std::vector<std::pair<const char*, any_pool*>> pools = {{"ticks", &ticks}, {"names", &names}};
+    for (auto& [name, p] : pools) {
+        print_pool_stats(name, *p);
+        size_t bytes = 0;
+        p->visit_slots([&](const raw_slot& slot) { bytes += slot.size; });
+        size_t moved = p->compact(nullptr);
+        size_t released = p->trim();
+        std::cout << "[" << name << "] " << bytes << " bytes of live objects, compacted " << moved
+                  << " objects, trimmed " << released << " bytes\n";
+        print_pool_stats(name, *p);
+    }
+}
+
 int main() {
     constexpr size_t N = 10000000; // 10 million
     pool<MyClass> p(4);
@@ -215,5 +4370,30 @@ int main() {
     }
     std::cout << "After erase and block release:\n";
     print_memory_usage();
+    bench_fixed_geometry();
+    demo_any_pool();
+    bench_uninit_emplace();
+    bench_packed_small();
+    bench_stride_coloring();
+    bench_page_runs();
+    bench_reserved_range();
+    demo_scavenger();
+    demo_pressure_monitor();
+    bench_intern();
+    bench_sparse_ids();
+    demo_tenant_tags();
+    bench_background_growth();
+    bench_realtime();
+    demo_memory_lock();
+    bench_claim_batches();
+    bench_occupancy_kernels();
+    bench_reorder_by_key();
+    bench_scatter_gather();
+    bench_allocate_shared();
+    demo_index_containers();
+    bench_handoff_queues();
+    bench_lease();
+    demo_asan_poisoning();
+    bench_growth_policies();
     return 0;
 }
\ No newline at end of file